@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "src/Allocator.cpp"
+#include "src/PoolAllocator.h"
+
+/**
+ * Allocator benchmarks. Every (workload, allocator) pair runs in a forked
+ * child, so the peak RSS reported by wait4() belongs to that pair alone.
+ * Throughput is measured on an untimed pass, p99 latency on a second pass
+ * that times every operation.
+ *
+ * Usage: ./bench.sh [scale], scale multiplies all workload sizes (default 1).
+ */
+
+using Clock = std::chrono::steady_clock;
+
+template <typename T> using ChunkAllocator = Allocator<T>;
+
+template <typename T>
+using HugeChunkAllocator = Allocator<T, GeometricGrowth<>, MmapSource<true>>;
+
+template <typename T> struct MallocAllocator {
+  using value_type = T;
+
+  MallocAllocator() = default;
+
+  template <typename U> MallocAllocator(const MallocAllocator<U> &other) {}
+
+  T *allocate(const size_t n) {
+    auto p = static_cast<T *>(malloc(n * sizeof(T)));
+    if (!p) {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+
+  void deallocate(T *p, const size_t n) { free(p); }
+
+  template <typename U> bool operator==(const MallocAllocator<U> &) const {
+    return true;
+  }
+
+  template <typename U> bool operator!=(const MallocAllocator<U> &) const {
+    return false;
+  }
+};
+
+// every thread bumps through its own monotonic buffer
+template <typename T>
+struct MonotonicAllocator : std::pmr::polymorphic_allocator<T> {
+  template <typename U> struct rebind { typedef MonotonicAllocator<U> other; };
+
+  MonotonicAllocator()
+      : std::pmr::polymorphic_allocator<T>(&threadResource()) {}
+
+  template <typename U>
+  MonotonicAllocator(const MonotonicAllocator<U> &other)
+      : std::pmr::polymorphic_allocator<T>(other.resource()) {}
+
+  static std::pmr::monotonic_buffer_resource &threadResource() {
+    thread_local std::pmr::monotonic_buffer_resource resource;
+    return resource;
+  }
+};
+
+struct Result {
+  double opsPerSecond;
+  double p99Nanos;
+};
+
+class LatencyRecorder {
+private:
+  std::vector<double> samples;
+  Clock::time_point start;
+
+public:
+  explicit LatencyRecorder(const size_t count) { samples.reserve(count); }
+
+  void begin() { start = Clock::now(); }
+
+  void end() {
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+  }
+
+  double p99() {
+    if (samples.empty()) {
+      return 0.0;
+    }
+    auto nth = samples.begin() + samples.size() * 99 / 100;
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+  }
+};
+
+template <typename Body> double secondsOf(Body body) {
+  auto start = Clock::now();
+  body();
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <template <typename> class Alloc>
+Result vectorPushBack(const size_t scale) {
+  const size_t size = 1000000 * scale, rounds = 20;
+  double seconds = secondsOf([&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      std::vector<int, Alloc<int>> vec;
+      for (size_t i = 0; i < size; ++i) {
+        vec.push_back(static_cast<int>(i));
+      }
+    }
+  });
+
+  LatencyRecorder latency(size);
+  std::vector<int, Alloc<int>> vec;
+  for (size_t i = 0; i < size; ++i) {
+    latency.begin();
+    vec.push_back(static_cast<int>(i));
+    latency.end();
+  }
+  return {size * rounds / seconds, latency.p99()};
+}
+
+template <template <typename> class Alloc>
+Result listChurn(const size_t scale) {
+  const size_t size = 100000 * scale, rounds = 50;
+  std::list<int, Alloc<int>> list;
+  for (size_t i = 0; i < size; ++i) {
+    list.push_back(static_cast<int>(i));
+  }
+  double seconds = secondsOf([&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < size; ++i) {
+        list.pop_front();
+        list.push_back(static_cast<int>(i));
+      }
+    }
+  });
+
+  LatencyRecorder latency(size);
+  for (size_t i = 0; i < size; ++i) {
+    latency.begin();
+    list.pop_front();
+    list.push_back(static_cast<int>(i));
+    latency.end();
+  }
+  return {size * rounds / seconds, latency.p99()};
+}
+
+template <template <typename> class Alloc>
+Result mapChurn(const size_t scale) {
+  using Map =
+      std::map<int, int, std::less<int>, Alloc<std::pair<const int, int>>>;
+  const size_t size = 100000 * scale, rounds = 20;
+  std::mt19937 rand(42);
+  std::uniform_int_distribution<int> keys(0, static_cast<int>(size) * 4);
+  Map map;
+  for (size_t i = 0; i < size; ++i) {
+    map.emplace(keys(rand), 0);
+  }
+  double seconds = secondsOf([&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < size; ++i) {
+        auto victim = map.lower_bound(keys(rand));
+        map.erase(victim == map.end() ? map.begin() : victim);
+        map.emplace(keys(rand), 0);
+      }
+    }
+  });
+
+  LatencyRecorder latency(size);
+  for (size_t i = 0; i < size; ++i) {
+    const int key = keys(rand);
+    latency.begin();
+    map.erase(key);
+    map.emplace(key ^ 1, 0);
+    latency.end();
+  }
+  return {size * rounds / seconds, latency.p99()};
+}
+
+struct Small {
+  uint64_t payload[4];
+};
+
+template <template <typename> class Alloc>
+Result smallThreads(const size_t scale) {
+  const size_t threads = std::max(2u, std::thread::hardware_concurrency());
+  const size_t perThread = 1000000 * scale, batch = 16;
+  std::vector<double> p99s(threads);
+
+  auto worker = [&](const size_t id) {
+    Alloc<Small> alloc;
+    Small *live[batch];
+    LatencyRecorder latency(perThread / 10);
+    for (size_t i = 0; i < perThread; i += batch) {
+      const bool timed = i % (batch * 10) == 0;
+      for (size_t j = 0; j < batch; ++j) {
+        if (timed) {
+          latency.begin();
+        }
+        live[j] = alloc.allocate(1);
+        live[j]->payload[0] = j;
+        if (timed) {
+          latency.end();
+        }
+      }
+      for (size_t j = 0; j < batch; ++j) {
+        alloc.deallocate(live[j], 1);
+      }
+    }
+    p99s[id] = latency.p99();
+  };
+
+  double seconds = secondsOf([&] {
+    std::vector<std::thread> pool;
+    for (size_t id = 0; id < threads; ++id) {
+      pool.emplace_back(worker, id);
+    }
+    for (auto &thread : pool) {
+      thread.join();
+    }
+  });
+  return {threads * perThread / seconds,
+          *std::max_element(p99s.begin(), p99s.end())};
+}
+
+// pointer chasing over nodes spread across a big arena: dominated by TLB
+// misses unless the arena sits on huge pages
+struct Node {
+  Node *next;
+  uint64_t payload[7];
+};
+
+template <template <typename> class Alloc>
+Result tlbPointerChase(const size_t scale) {
+  const size_t count = (1u << 22) * scale, steps = 20000000;
+  Alloc<Node> alloc;
+  std::vector<Node *> nodes(count);
+  for (auto &node : nodes) {
+    node = alloc.allocate(1);
+  }
+  std::shuffle(nodes.begin(), nodes.end(), std::mt19937(42));
+  for (size_t i = 0; i < count; ++i) {
+    nodes[i]->next = nodes[(i + 1) % count];
+  }
+
+  Node *current = nodes[0];
+  double seconds = secondsOf([&] {
+    for (size_t i = 0; i < steps; ++i) {
+      current = current->next;
+    }
+  });
+
+  LatencyRecorder latency(steps / 100);
+  for (size_t i = 0; i < steps / 100; ++i) {
+    latency.begin();
+    current = current->next;
+    latency.end();
+  }
+  if (current == nullptr) {
+    std::cerr << "unreachable" << std::endl;
+  }
+  for (auto node : nodes) {
+    alloc.deallocate(node, 1);
+  }
+  return {steps / seconds, latency.p99()};
+}
+
+template <typename Workload>
+void runIsolated(const std::string &workload, const std::string &allocator,
+                 Workload body) {
+  std::cout.flush();
+  int pipeFd[2];
+  if (pipe(pipeFd) != 0) {
+    throw std::runtime_error("pipe failed");
+  }
+  pid_t child = fork();
+  if (child == 0) {
+    close(pipeFd[0]);
+    Result result = body();
+    if (write(pipeFd[1], &result, sizeof(result)) != sizeof(result)) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  close(pipeFd[1]);
+  Result result{};
+  const bool ok = read(pipeFd[0], &result, sizeof(result)) == sizeof(result);
+  close(pipeFd[0]);
+  int status = 0;
+  struct rusage usage {};
+  wait4(child, &status, 0, &usage);
+
+  std::cout << std::left << std::setw(18) << workload << std::setw(20)
+            << allocator << std::right;
+  if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cout << "  failed" << std::endl;
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(2) << std::setw(12)
+            << result.opsPerSecond / 1e6 << std::setw(12) << result.p99Nanos
+            << std::setw(12) << usage.ru_maxrss / 1024.0 << std::endl;
+}
+
+#define RUN(workload, alloc)                                                   \
+  runIsolated(#workload, #alloc, [scale] { return workload<alloc>(scale); })
+
+#define RUN_ALL(workload)                                                      \
+  RUN(workload, ChunkAllocator);                                               \
+  RUN(workload, PoolAllocator);                                                \
+  RUN(workload, MonotonicAllocator);                                           \
+  RUN(workload, MallocAllocator);                                              \
+  RUN(workload, std::allocator)
+
+int main(int argc, char **argv) {
+  const size_t scale = argc > 1 ? std::stoul(argv[1]) : 1;
+
+  std::cout << std::left << std::setw(18) << "workload" << std::setw(20)
+            << "allocator" << std::right << std::setw(12) << "Mops/s"
+            << std::setw(12) << "p99 ns" << std::setw(12) << "peak MB"
+            << std::endl;
+
+  RUN_ALL(vectorPushBack);
+  RUN_ALL(listChurn);
+  RUN_ALL(mapChurn);
+  RUN_ALL(smallThreads);
+  RUN_ALL(tlbPointerChase);
+  RUN(tlbPointerChase, HugeChunkAllocator);
+
+  return 0;
+}
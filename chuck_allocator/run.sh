@@ -0,0 +1,11 @@
+#!/bin/bash
+
+set -e
+
+mkdir -p build
+g++ -std=c++17 -pthread -I./ test/test.cpp -o build/allocator_test
+./build/allocator_test
+g++ -std=c++17 -pthread -DALLOCATOR_STATS -I./ test/test.cpp -o build/allocator_stats_test
+./build/allocator_stats_test
+
+echo All tests passed!
@@ -1,54 +1,153 @@
 //
 // Created by berlioz on 26.10.2020.
 //
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <typeindex>
+#include <utility>
 #include <vector>
 
-#define MULT 1000
+#include "AllocatorStats.h"
+#include "ChunkPolicies.h"
 
-template <typename T> class Chunk {
+template <typename T, typename Source = HeapSource> class Chunk {
 private:
   uint8_t *p;
+  std::size_t capacity;
   std::size_t sizeLeft;
-  Chunk<T> *prev;
-  inline static size_t chunkRefCnt = 0;
+  std::size_t inUse;
+  Chunk<T, Source> *prev;
 
 public:
-  Chunk<T>() : prev(nullptr) {
-    p = new u_int8_t[MULT * sizeof(T)];
-    sizeLeft = MULT;
-    ++chunkRefCnt;
+  explicit Chunk(const std::size_t capacity)
+      : capacity(capacity), sizeLeft(capacity), inUse(0), prev(nullptr) {
+    p = Source::acquire(capacity * sizeof(T));
   }
 
-  ~Chunk<T>() {
-    if (chunkRefCnt > 1) {
-      --chunkRefCnt;
-    } else {
-      delete[] p;
-    }
-    if (prev) {
-      prev->~Chunk<T>();
-    }
+  Chunk(const Chunk &copy) = delete;
+
+  Chunk &operator=(const Chunk &other) = delete;
+
+  ~Chunk() { Source::release(p, capacity * sizeof(T)); }
+
+  // bump allocation: blocks are handed out one after another
+  T *allocate(const size_t n) {
+    T *block = reinterpret_cast<T *>(p) + (capacity - sizeLeft);
+    sizeLeft -= n;
+    inUse += n;
+    return block;
   }
 
-  void allocate(const size_t n) { sizeLeft -= n; }
+  // once every block is returned the chunk starts over from its beginning
+  void deallocate(const size_t n) {
+    inUse -= n;
+    if (inUse == 0) {
+      sizeLeft = capacity;
+      Source::discard(p, capacity * sizeof(T));
+    }
+  }
 
-  template <typename... Args> void construct(Args &&... args) {
-    new (p) T(args...);
+  bool owns(const T *block) const {
+    auto begin = reinterpret_cast<const T *>(p);
+    return begin <= block && block < begin + capacity;
   }
 
+  std::size_t getCapacity() const { return capacity; }
+
   std::size_t getSizeLeft() { return sizeLeft; }
 
   uint8_t *getPointer() const { return p; }
 
-  Chunk<T> *getPrev() { return prev; }
+  Chunk<T, Source> *getPrev() { return prev; }
+
+  void setPrev(Chunk<T, Source> *prevChunk) { prev = prevChunk; }
+};
+
+struct ChunkListBase {
+  virtual ~ChunkListBase() = default;
+};
+
+// chunks of one element type, freed by walking the list iteratively
+template <typename T, typename Source> struct ChunkList : ChunkListBase {
+  Chunk<T, Source> *chunk = nullptr;
+  AllocatorStats &stats;
+
+  explicit ChunkList(AllocatorStats &stats) : stats(stats) {}
 
-  void setPrev(Chunk<T> *prevChunk) { prev = prevChunk; }
+  ~ChunkList() override {
+    size_t count = 0, bytes = 0;
+    while (chunk) {
+      auto prev = chunk->getPrev();
+      ++count;
+      bytes += chunk->getCapacity() * sizeof(T);
+      delete chunk;
+      chunk = prev;
+    }
+    stats.onChunksReleased(count, bytes);
+  }
 };
 
-template <typename T> class Allocator {
+/**
+ * Everything an allocator shares with its copies and rebound copies: one
+ * ChunkList per element type, so memory of different types is never mixed,
+ * and one set of statistics. The last consumer to go away frees it all.
+ */
+template <typename Source> struct ChunkGroup {
+  std::size_t consumers = 1;
+  AllocatorStats stats;
+  // declared after stats: the lists report their release into it
+  std::vector<std::pair<std::type_index, std::unique_ptr<ChunkListBase>>>
+      lists;
+
+  template <typename T> ChunkList<T, Source> *list() {
+    for (auto &entry : lists) {
+      if (entry.first == typeid(T)) {
+        return static_cast<ChunkList<T, Source> *>(entry.second.get());
+      }
+    }
+    lists.emplace_back(typeid(T),
+                       std::make_unique<ChunkList<T, Source>>(stats));
+    return static_cast<ChunkList<T, Source> *>(lists.back().second.get());
+  }
+};
+
+/**
+ * Chunk allocator. Copies and rebound copies share one ChunkGroup and
+ * compare equal, so memory can be returned through any of them. Like
+ * PoolAllocator, it is not thread-safe: the consumer counter and the chunk
+ * lists are not synchronized, so every thread needs its own allocator.
+ */
+
+template <typename T, typename Growth = GeometricGrowth<>,
+          typename Source = HeapSource>
+class Allocator {
 private:
-  Chunk<T> *chunk;
+  template <typename U, typename G, typename S> friend class Allocator;
+
+  ChunkGroup<Source> *group;
+  ChunkList<T, Source> *chunks;
+
+  // large blocks get their own anonymous mapping, so they can be given back
+  // to the system right away instead of pinning a whole chunk
+  static T *mapLarge(const size_t n) {
+    void *block = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(block);
+  }
+
+  void release() {
+    if (--group->consumers == 0) {
+      delete group;
+    }
+  }
 
 public:
   using value_type = T;
@@ -57,65 +156,114 @@ public:
   using reference = T &;
   using const_reference = const T &;
   using size_type = std::size_t;
-  using rebind = struct rebind { typedef Allocator<T> other; };
+  using difference_type = std::ptrdiff_t;
+  template <typename U> struct rebind {
+    typedef Allocator<U, Growth, Source> other;
+  };
 
-  Allocator<T>() : chunk(nullptr){};
-  ~Allocator() {
-    if (chunk) {
-      chunk->~Chunk<T>();
-    }
+  Allocator()
+      : group(new ChunkGroup<Source>()),
+        chunks(group->template list<T>()){};
+
+  // copies are consumers of the same chunks
+  Allocator(const Allocator &copy) : group(copy.group), chunks(copy.chunks) {
+    ++group->consumers;
+  }
+
+  // a rebound allocator joins the same group but takes chunks of its own
+  // element type
+  template <typename U>
+  Allocator(const Allocator<U, Growth, Source> &other)
+      : group(other.group), chunks(group->template list<T>()) {
+    ++group->consumers;
   }
 
+  Allocator &operator=(const Allocator &other) {
+    ++other.group->consumers;
+    release();
+    group = other.group;
+    chunks = other.chunks;
+    return *this;
+  }
+
+  ~Allocator() { release(); }
+
   T *allocate(const size_t &n) {
+    auto &chunk = chunks->chunk;
+    auto &stats = group->stats;
     if (n > max_size()) {
       throw std::runtime_error("Trying to allocate more than allowed!");
     }
+    if (n > Growth::cap) {
+      stats.onAllocate(n * sizeof(T), true);
+      return mapLarge(n);
+    }
+    stats.onAllocate(n * sizeof(T), false);
 
     if (!chunk) {
-      chunk = new Chunk<T>();
+      chunk = new Chunk<T, Source>(Growth::initial);
+      stats.onChunkCreated(Growth::initial * sizeof(T));
     }
     if (n <= chunk->getSizeLeft()) {
-      chunk->allocate(n);
-      return reinterpret_cast<T *>(chunk->getPointer());
+      return chunk->allocate(n);
     } else {
+      stats.onFailedFit();
       // check all previous chunks for spare memory
       auto prev = chunk->getPrev();
       while (prev != nullptr) {
         if (n <= prev->getSizeLeft()) {
-          prev->allocate(n);
-          return reinterpret_cast<T *>(prev->getPointer());
+          return prev->allocate(n);
         }
+        stats.onFailedFit();
         prev = prev->getPrev();
       }
-      // no luck, gotta create a new chunk
-      auto newChunk = new Chunk<T>();
+      // no luck, gotta create a new chunk, big enough to fit the request
+      size_t capacity = Growth::next(chunk->getCapacity());
+      while (capacity < n) {
+        capacity = Growth::next(capacity);
+      }
+      auto newChunk = new Chunk<T, Source>(capacity);
+      stats.onChunkCreated(capacity * sizeof(T));
       newChunk->setPrev(chunk);
       chunk = newChunk;
-      chunk->allocate(n);
-      return reinterpret_cast<T *>(chunk->getPointer());
+      return chunk->allocate(n);
     }
   }
 
   void deallocate(T *p, const size_t n) {
-    // do nothing
+    group->stats.onDeallocate(n * sizeof(T), n > Growth::cap);
+    if (n > Growth::cap) {
+      munmap(p, n * sizeof(T));
+      return;
+    }
+    // chunk memory itself is released once the last consumer is gone
+    for (auto owner = chunks->chunk; owner; owner = owner->getPrev()) {
+      if (owner->owns(p)) {
+        owner->deallocate(n);
+        return;
+      }
+    }
   }
 
   template <typename... Args> void construct(T *p, Args &&... args) {
-    chunk->construct(args...);
+    new (p) T(std::forward<Args>(args)...);
   }
 
   void destroy(T *p) { p->~T(); }
 
-  std::size_t max_size() { return MULT * sizeof(T); }
-};
+  const AllocatorStats &getStats() const { return group->stats; }
 
-// int main() {
-// std::vector<int, Allocator<int>> vec;
-// for(int i = 0; i < MULT; ++i) {
-//   vec.push_back(1);
-// }
-//  for(int i = 0; i < MULT; ++i) {
-//    vec.push_back(2);
-//  }
-// std::cout << vec[0] << std::endl;
-//}
\ No newline at end of file
+  std::size_t max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  template <typename U>
+  bool operator==(const Allocator<U, Growth, Source> &other) const {
+    return group == other.group;
+  }
+
+  template <typename U>
+  bool operator!=(const Allocator<U, Growth, Source> &other) const {
+    return !(*this == other);
+  }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <execinfo.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#define SAMPLE_DEPTH 6
+
+/**
+ * Counters of what a chunk allocator does. Every allocator keeps its own set
+ * and mirrors each event into AllocatorStats::global(). Recording is compiled
+ * in only with -DALLOCATOR_STATS; otherwise all hooks are empty and
+ * dumpJson() reports that statistics are disabled.
+ *
+ * Call sites can additionally be sampled: with setSampleRate(n) every n-th
+ * allocation records its innermost SAMPLE_DEPTH return addresses into the
+ * global table (resolve them with addr2line; the first ones usually belong to
+ * the allocator and the container that called it).
+ */
+class AllocatorStats {
+public:
+  AllocatorStats() = default;
+
+  // a copy starts from a snapshot of the counters
+  AllocatorStats(const AllocatorStats &copy) {
+#ifdef ALLOCATOR_STATS
+    for (size_t i = 0; i < COUNTERS; ++i) {
+      counters[i].store(copy.counters[i].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    }
+#endif
+  }
+
+  AllocatorStats &operator=(const AllocatorStats &other) = delete;
+
+  static AllocatorStats &global() {
+    static AllocatorStats stats;
+    return stats;
+  }
+
+  static void setSampleRate(const size_t rate) {
+#ifdef ALLOCATOR_STATS
+    sampleRate.store(rate, std::memory_order_relaxed);
+#endif
+  }
+
+  void onChunkCreated(const size_t bytes) {
+#ifdef ALLOCATOR_STATS
+    record(CHUNKS_CREATED, 1);
+    record(CHUNK_BYTES, bytes);
+#endif
+  }
+
+  void onChunksReleased(const size_t count, const size_t bytes) {
+#ifdef ALLOCATOR_STATS
+    record(CHUNKS_RELEASED, count);
+    record(CHUNK_BYTES, -bytes);
+#endif
+  }
+
+  void onFailedFit() {
+#ifdef ALLOCATOR_STATS
+    record(FAILED_FITS, 1);
+#endif
+  }
+
+  void onAllocate(const size_t bytes, const bool large) {
+#ifdef ALLOCATOR_STATS
+    record(ALLOCATIONS, 1);
+    record(large ? LARGE_BYTES_IN_USE : BYTES_IN_USE, bytes);
+    if (large) {
+      record(LARGE_ALLOCATIONS, 1);
+    }
+    updatePeak();
+    sample(bytes);
+#endif
+  }
+
+  void onDeallocate(const size_t bytes, const bool large) {
+#ifdef ALLOCATOR_STATS
+    record(DEALLOCATIONS, 1);
+    record(large ? LARGE_BYTES_IN_USE : BYTES_IN_USE, -bytes);
+#endif
+  }
+
+  size_t chunksCreated() const { return get(CHUNKS_CREATED); }
+
+  size_t chunkBytes() const { return get(CHUNK_BYTES); }
+
+  size_t bytesInUse() const { return get(BYTES_IN_USE); }
+
+  size_t largeBytesInUse() const { return get(LARGE_BYTES_IN_USE); }
+
+  size_t peakBytesInUse() const { return get(PEAK_BYTES_IN_USE); }
+
+  size_t failedFits() const { return get(FAILED_FITS); }
+
+  // share of chunk memory that is not handed out right now
+  double fragmentation() const {
+    const size_t reserved = chunkBytes();
+    if (reserved == 0) {
+      return 0.0;
+    }
+    return 1.0 - static_cast<double>(bytesInUse()) / reserved;
+  }
+
+  void dumpJson(std::ostream &stream) const {
+#ifdef ALLOCATOR_STATS
+    stream << "{";
+    for (size_t i = 0; i < COUNTERS; ++i) {
+      stream << "\"" << NAMES[i] << "\": " << get(static_cast<Counter>(i))
+             << ", ";
+    }
+    stream << "\"fragmentation\": " << fragmentation();
+    if (this == &global()) {
+      dumpSamples(stream);
+    }
+    stream << "}";
+#else
+    stream << "{\"enabled\": false}";
+#endif
+  }
+
+private:
+  enum Counter {
+    CHUNKS_CREATED,
+    CHUNKS_RELEASED,
+    CHUNK_BYTES,
+    BYTES_IN_USE,
+    LARGE_BYTES_IN_USE,
+    PEAK_BYTES_IN_USE,
+    ALLOCATIONS,
+    DEALLOCATIONS,
+    LARGE_ALLOCATIONS,
+    FAILED_FITS,
+    COUNTERS
+  };
+
+  using Frames = std::array<void *, SAMPLE_DEPTH>;
+
+  struct Site {
+    size_t count;
+    size_t bytes;
+  };
+
+#ifdef ALLOCATOR_STATS
+  static constexpr const char *NAMES[COUNTERS] = {
+      "chunks_created",     "chunks_released",   "chunk_bytes",
+      "bytes_in_use",       "large_bytes_in_use", "peak_bytes_in_use",
+      "allocations",        "deallocations",     "large_allocations",
+      "failed_fits"};
+
+  std::atomic<size_t> counters[COUNTERS] = {};
+
+  inline static std::atomic<size_t> sampleRate{0};
+  inline static std::atomic<size_t> sampleTick{0};
+  inline static std::mutex samplesMutex;
+  inline static std::map<Frames, Site> samples;
+
+  void record(const Counter counter, const size_t delta) {
+    counters[counter].fetch_add(delta, std::memory_order_relaxed);
+    if (this != &global()) {
+      global().counters[counter].fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+  static void raisePeak(std::atomic<size_t> *counters) {
+    const size_t current =
+        counters[BYTES_IN_USE].load(std::memory_order_relaxed) +
+        counters[LARGE_BYTES_IN_USE].load(std::memory_order_relaxed);
+    auto &peak = counters[PEAK_BYTES_IN_USE];
+    size_t seen = peak.load(std::memory_order_relaxed);
+    while (seen < current && !peak.compare_exchange_weak(
+                                 seen, current, std::memory_order_relaxed)) {
+    }
+  }
+
+  void updatePeak() {
+    raisePeak(counters);
+    if (this != &global()) {
+      raisePeak(global().counters);
+    }
+  }
+
+  // noinline keeps sample() itself as the only frame to skip
+  __attribute__((noinline)) static void sample(const size_t bytes) {
+    const size_t rate = sampleRate.load(std::memory_order_relaxed);
+    if (rate == 0 ||
+        sampleTick.fetch_add(1, std::memory_order_relaxed) % rate != 0) {
+      return;
+    }
+    void *frames[SAMPLE_DEPTH + 1];
+    const int depth = backtrace(frames, SAMPLE_DEPTH + 1);
+    Frames site = {};
+    for (int i = 1; i < depth; ++i) {
+      site[i - 1] = frames[i];
+    }
+
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    auto &entry = samples[site];
+    ++entry.count;
+    entry.bytes += bytes;
+  }
+
+  static void dumpSamples(std::ostream &stream) {
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    stream << ", \"samples\": [";
+    bool first = true;
+    for (const auto &[frames, site] : samples) {
+      stream << (first ? "" : ", ") << "{\"count\": " << site.count
+             << ", \"bytes\": " << site.bytes << ", \"frames\": [";
+      first = false;
+      for (size_t i = 0; i < SAMPLE_DEPTH && frames[i]; ++i) {
+        stream << (i ? ", " : "") << "\"" << frames[i] << "\"";
+      }
+      stream << "]}";
+    }
+    stream << "]";
+  }
+#endif
+
+  size_t get(const Counter counter) const {
+#ifdef ALLOCATOR_STATS
+    return counters[counter].load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+  }
+};
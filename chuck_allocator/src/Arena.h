@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ChunkPolicies.h"
+
+#define ARENA_CHUNK_SIZE (64u << 10)
+#define ARENA_MAX_CHUNK_SIZE (64u << 20)
+
+/**
+ * Scoped bump arena on top of a chunk list. Memory is never returned piece by
+ * piece: mark() remembers the current position, rewind() goes back to it and
+ * reset() goes back to the very beginning. Both are O(1) unless objects with
+ * non-trivial destructors were created with create(): those destructors run
+ * (newest first) when the arena is rewound past them.
+ *
+ * Chunks are kept between resets and reused in order, so a per-request
+ * scratch arena stops touching the global heap after the first few requests.
+ * Chunk sizes are in bytes and follow the Growth policy; requests larger than
+ * its cap get a dedicated chunk.
+ */
+template <typename Growth =
+              GeometricGrowth<ARENA_CHUNK_SIZE, ARENA_MAX_CHUNK_SIZE>,
+          typename Source = HeapSource>
+class Arena {
+private:
+  struct alignas(std::max_align_t) ArenaChunk {
+    ArenaChunk *next;
+    std::size_t capacity;
+
+    uint8_t *begin() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+    uint8_t *end() { return begin() + capacity; }
+  };
+
+  struct Finalizer {
+    void (*destroy)(void *);
+    void *object;
+    Finalizer *prev;
+  };
+
+  ArenaChunk *first;
+  ArenaChunk *last;
+  ArenaChunk *current;
+  uint8_t *top;
+  uint8_t *end;
+  Finalizer *finalizers;
+
+  static ArenaChunk *newChunk(const std::size_t capacity) {
+    auto chunk = reinterpret_cast<ArenaChunk *>(
+        Source::acquire(sizeof(ArenaChunk) + capacity));
+    chunk->next = nullptr;
+    chunk->capacity = capacity;
+    return chunk;
+  }
+
+  void enter(ArenaChunk *chunk) {
+    current = chunk;
+    top = chunk->begin();
+    end = chunk->end();
+  }
+
+  // moves on to the next chunk that can hold the request, creating one if
+  // needed; chunks skipped on the way stay in the list for later resets
+  void advance(const std::size_t bytes, const std::size_t alignment) {
+    const std::size_t needed = bytes + alignment;
+    ArenaChunk *next = current ? current->next : first;
+    while (next && next->capacity < needed) {
+      next = next->next;
+    }
+    if (!next) {
+      std::size_t capacity =
+          last ? Growth::next(last->capacity) : Growth::initial;
+      if (capacity < needed) {
+        capacity = needed;
+      }
+      next = newChunk(capacity);
+      if (last) {
+        last->next = next;
+      } else {
+        first = next;
+      }
+      last = next;
+    }
+    enter(next);
+  }
+
+  void runFinalizers(const Finalizer *until) {
+    while (finalizers != until) {
+      finalizers->destroy(finalizers->object);
+      finalizers = finalizers->prev;
+    }
+  }
+
+  template <typename T> static void destroyObject(void *object) {
+    static_cast<T *>(object)->~T();
+  }
+
+public:
+  struct Mark {
+    ArenaChunk *chunk;
+    uint8_t *top;
+    Finalizer *finalizers;
+  };
+
+  Arena()
+      : first(nullptr), last(nullptr), current(nullptr), top(nullptr),
+        end(nullptr), finalizers(nullptr) {}
+
+  Arena(const Arena &copy) = delete;
+
+  Arena &operator=(const Arena &other) = delete;
+
+  ~Arena() {
+    reset();
+    while (first) {
+      ArenaChunk *next = first->next;
+      Source::release(reinterpret_cast<uint8_t *>(first),
+                      sizeof(ArenaChunk) + first->capacity);
+      first = next;
+    }
+  }
+
+  void *allocate(const std::size_t bytes,
+                 const std::size_t alignment = alignof(std::max_align_t)) {
+    auto address = reinterpret_cast<uintptr_t>(top);
+    auto aligned = (address + alignment - 1) & ~(alignment - 1);
+    if (!current || aligned + bytes > reinterpret_cast<uintptr_t>(end)) {
+      advance(bytes, alignment);
+      address = reinterpret_cast<uintptr_t>(top);
+      aligned = (address + alignment - 1) & ~(alignment - 1);
+    }
+    top = reinterpret_cast<uint8_t *>(aligned + bytes);
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  template <typename T> T *allocateArray(const std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+  }
+
+  // constructs an object in the arena; its destructor, if any, is recorded
+  // and run on rewind() or reset()
+  template <typename T, typename... Args> T *create(Args &&... args) {
+    void *memory = allocate(sizeof(T), alignof(T));
+    T *object = new (memory) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      auto finalizer = static_cast<Finalizer *>(
+          allocate(sizeof(Finalizer), alignof(Finalizer)));
+      finalizer->destroy = &destroyObject<T>;
+      finalizer->object = object;
+      finalizer->prev = finalizers;
+      finalizers = finalizer;
+    }
+    return object;
+  }
+
+  Mark mark() const { return Mark{current, top, finalizers}; }
+
+  void rewind(const Mark &mark) {
+    runFinalizers(mark.finalizers);
+    current = mark.chunk;
+    top = mark.top;
+    end = current ? current->end() : nullptr;
+  }
+
+  void reset() { rewind(Mark{nullptr, nullptr, nullptr}); }
+
+  // bytes reserved from the source, used or not
+  std::size_t capacity() const {
+    std::size_t total = 0;
+    for (ArenaChunk *chunk = first; chunk; chunk = chunk->next) {
+      total += chunk->capacity;
+    }
+    return total;
+  }
+};
+
+/**
+ * STL-compatible view of an Arena: deallocate() does nothing, memory comes
+ * back when the arena is rewound or reset.
+ */
+template <typename T, typename ArenaType = Arena<>> class ArenaAllocator {
+private:
+  template <typename U, typename A> friend class ArenaAllocator;
+
+  ArenaType *arena;
+
+public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  template <typename U> struct rebind {
+    typedef ArenaAllocator<U, ArenaType> other;
+  };
+
+  explicit ArenaAllocator(ArenaType &arena) : arena(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U, ArenaType> &other)
+      : arena(other.arena) {}
+
+  T *allocate(const size_t n) { return arena->template allocateArray<T>(n); }
+
+  void deallocate(T *p, const size_t n) {
+    // do nothing
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U, ArenaType> &other) const {
+    return arena == other.arena;
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U, ArenaType> &other) const {
+    return arena != other.arena;
+  }
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MULT 1000
+#define MAX_CHUNK_MULT (MULT * 1024)
+#define HUGE_PAGE_SIZE (2u << 20)
+
+/**
+ * Chunk sizing policy: the first chunk holds Initial elements and every next
+ * one is twice as big as the previous, until Cap elements are reached.
+ * Requests for more than Cap elements are not served from chunks at all.
+ */
+template <std::size_t Initial = MULT, std::size_t Cap = MAX_CHUNK_MULT>
+struct GeometricGrowth {
+  static_assert(Initial > 0 && Initial <= Cap,
+                "Initial chunk size should be in (0, Cap]");
+
+  static constexpr std::size_t initial = Initial;
+  static constexpr std::size_t cap = Cap;
+
+  static std::size_t next(const std::size_t current) {
+    return current < cap / 2 ? current * 2 : cap;
+  }
+};
+
+/**
+ * Chunk memory straight from the heap.
+ */
+struct HeapSource {
+  static uint8_t *acquire(const std::size_t bytes) {
+    return new u_int8_t[bytes];
+  }
+
+  static void release(uint8_t *p, const std::size_t bytes) { delete[] p; }
+
+  // heap memory can't be handed back partially, so an empty chunk keeps it
+  static void discard(uint8_t *p, const std::size_t bytes) {}
+};
+
+/**
+ * Chunk memory from anonymous mappings. With HugePages the mapping is aligned
+ * to HUGE_PAGE_SIZE and advised as MADV_HUGEPAGE before being prefaulted, so
+ * the kernel backs it with transparent huge pages and big arenas take far
+ * fewer TLB misses. Emptied chunks give their pages back with MADV_DONTNEED
+ * but keep the address range.
+ */
+template <bool HugePages = true> struct MmapSource {
+  static std::size_t mappedSize(const std::size_t bytes) {
+    const std::size_t page =
+        HugePages ? HUGE_PAGE_SIZE : static_cast<std::size_t>(getpagesize());
+    return (bytes + page - 1) / page * page;
+  }
+
+  static uint8_t *acquire(const std::size_t bytes) {
+    const std::size_t size = mappedSize(bytes);
+    if (!HugePages) {
+      void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+      if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      return static_cast<uint8_t *>(p);
+    }
+
+    // map one huge page extra and trim both ends to get an aligned range;
+    // MAP_POPULATE is not used here, since it would fault in 4K pages before
+    // the advice below takes effect
+    void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    auto begin = reinterpret_cast<uintptr_t>(raw);
+    auto aligned =
+        (begin + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned > begin) {
+      munmap(raw, aligned - begin);
+    }
+    munmap(reinterpret_cast<void *>(aligned + size),
+           begin + HUGE_PAGE_SIZE - aligned);
+
+    auto p = reinterpret_cast<uint8_t *>(aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(p, size, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(p, size, MADV_POPULATE_WRITE) == 0) {
+      return p;
+    }
+#endif
+    for (std::size_t offset = 0; offset < size; offset += getpagesize()) {
+      p[offset] = 0;
+    }
+    return p;
+  }
+
+  static void release(uint8_t *p, const std::size_t bytes) {
+    munmap(p, mappedSize(bytes));
+  }
+
+  static void discard(uint8_t *p, const std::size_t bytes) {
+    madvise(p, mappedSize(bytes), MADV_DONTNEED);
+  }
+};
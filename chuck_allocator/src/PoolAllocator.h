@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define SLOT_ALIGN 16
+#define SLOT_CLASSES 16
+#define POOL_BLOCK_SIZE (64u << 10)
+
+/**
+ * Free lists of fixed-size slots, one per size class (SLOT_ALIGN, 2 *
+ * SLOT_ALIGN, ... SLOT_CLASSES * SLOT_ALIGN bytes). Unused slots hold the
+ * pointer to the next free one, so taking and returning a slot is a pop and a
+ * push. Fresh slots are cut lazily from POOL_BLOCK_SIZE blocks, which live
+ * until the last consumer of the pools is gone.
+ */
+class SlotPools {
+private:
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+
+  struct alignas(SLOT_ALIGN) Block {
+    Block *next;
+  };
+
+  FreeSlot *freeLists[SLOT_CLASSES] = {};
+  uint8_t *bump[SLOT_CLASSES] = {};
+  uint8_t *bumpEnd[SLOT_CLASSES] = {};
+  Block *blocks = nullptr;
+  size_t consumers = 1;
+
+  void *refill(const size_t slotClass) {
+    const size_t slotSize = (slotClass + 1) * SLOT_ALIGN;
+    if (static_cast<size_t>(bumpEnd[slotClass] - bump[slotClass]) < slotSize) {
+      auto block = static_cast<Block *>(::operator new(POOL_BLOCK_SIZE));
+      block->next = blocks;
+      blocks = block;
+      bump[slotClass] = reinterpret_cast<uint8_t *>(block + 1);
+      bumpEnd[slotClass] = bump[slotClass] + POOL_BLOCK_SIZE - sizeof(Block);
+    }
+    void *slot = bump[slotClass];
+    bump[slotClass] += slotSize;
+    return slot;
+  }
+
+public:
+  SlotPools() = default;
+
+  SlotPools(const SlotPools &copy) = delete;
+
+  SlotPools &operator=(const SlotPools &other) = delete;
+
+  ~SlotPools() {
+    while (blocks) {
+      Block *next = blocks->next;
+      ::operator delete(blocks);
+      blocks = next;
+    }
+  }
+
+  void attach() { ++consumers; }
+
+  // returns true when the last consumer is gone
+  bool detach() { return --consumers == 0; }
+
+  void *allocate(const size_t slotClass) {
+    FreeSlot *slot = freeLists[slotClass];
+    if (slot) {
+      freeLists[slotClass] = slot->next;
+      return slot;
+    }
+    return refill(slotClass);
+  }
+
+  void deallocate(const size_t slotClass, void *p) {
+    auto slot = static_cast<FreeSlot *>(p);
+    slot->next = freeLists[slotClass];
+    freeLists[slotClass] = slot;
+  }
+};
+
+/**
+ * Allocator for node-based containers (std::list, std::set, std::map,
+ * std::unordered_map...): single objects come from SlotPools, everything else
+ * (arrays, bucket tables, over-aligned types) goes to operator new, with
+ * std::align_val_t for types aligned beyond __STDCPP_DEFAULT_NEW_ALIGNMENT__.
+ * Copies and rebound copies share the same pools, so a node can be returned
+ * through any allocator compared equal to the one that gave it out.
+ * Like Allocator, it is not thread-safe.
+ */
+template <typename T> class PoolAllocator {
+private:
+  template <typename U> friend class PoolAllocator;
+
+  static constexpr size_t SLOT_CLASS =
+      (sizeof(T) + SLOT_ALIGN - 1) / SLOT_ALIGN - 1;
+  static constexpr bool POOLED =
+      SLOT_CLASS < SLOT_CLASSES && alignof(T) <= SLOT_ALIGN;
+  static constexpr bool OVER_ALIGNED =
+      alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+  SlotPools *pools;
+
+  void release() {
+    if (pools->detach()) {
+      delete pools;
+    }
+  }
+
+public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  template <typename U> struct rebind { typedef PoolAllocator<U> other; };
+
+  PoolAllocator() : pools(new SlotPools()) {}
+
+  PoolAllocator(const PoolAllocator &copy) : pools(copy.pools) {
+    pools->attach();
+  }
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U> &copy) : pools(copy.pools) {
+    pools->attach();
+  }
+
+  PoolAllocator &operator=(const PoolAllocator &other) {
+    other.pools->attach();
+    release();
+    pools = other.pools;
+    return *this;
+  }
+
+  ~PoolAllocator() { release(); }
+
+  T *allocate(const size_t n) {
+    if (POOLED && n == 1) {
+      return static_cast<T *>(pools->allocate(SLOT_CLASS));
+    }
+    if (n > max_size()) {
+      throw std::bad_array_new_length();
+    }
+    if (OVER_ALIGNED) {
+      return static_cast<T *>(
+          ::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, const size_t n) {
+    if (POOLED && n == 1) {
+      pools->deallocate(SLOT_CLASS, p);
+    } else if (OVER_ALIGNED) {
+      ::operator delete(p, std::align_val_t(alignof(T)));
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename... Args> void construct(T *p, Args &&... args) {
+    new (p) T(std::forward<Args>(args)...);
+  }
+
+  void destroy(T *p) { p->~T(); }
+
+  std::size_t max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  template <typename U> bool operator==(const PoolAllocator<U> &other) const {
+    return pools == other.pools;
+  }
+
+  template <typename U> bool operator!=(const PoolAllocator<U> &other) const {
+    return pools != other.pools;
+  }
+};
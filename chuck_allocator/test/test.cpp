@@ -0,0 +1,255 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/Allocator.cpp"
+#include "src/Arena.h"
+#include "src/PoolAllocator.h"
+
+void FailWithMsg(const std::string &msg, int line) {
+  std::cerr << "Test failed!\n";
+  std::cerr << "[Line " << line << "] " << msg << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+#define ASSERT_TRUE_MSG(cond, msg)                                             \
+  if (!(cond)) {                                                               \
+    FailWithMsg(msg, __LINE__);                                                \
+  };
+
+// small chunks, so a few hundred elements already span several of them
+using SmallGrowth = GeometricGrowth<16, 1024>;
+
+// records the order in which arena objects are destroyed
+struct Tracked {
+  std::vector<int> &log;
+  int id;
+
+  Tracked(std::vector<int> &log, int id) : log(log), id(id) {}
+
+  ~Tracked() { log.push_back(id); }
+};
+
+struct alignas(64) Wide {
+  char bytes[64];
+};
+
+int main() {
+  // containers that outgrow the first chunk
+  {
+    std::vector<int, Allocator<int, SmallGrowth>> vec;
+    for (int i = 0; i < 5000; ++i) {
+      vec.push_back(i);
+    }
+    bool intact = true;
+    for (int i = 0; i < 5000; ++i) {
+      intact = intact && vec[i] == i;
+    }
+    ASSERT_TRUE_MSG(intact, "Vector growing past one chunk")
+
+    std::list<int, Allocator<int, SmallGrowth>> list;
+    for (int i = 0; i < 3000; ++i) {
+      list.push_back(i);
+    }
+    for (auto it = list.begin(); it != list.end();) {
+      it = *it % 2 ? list.erase(it) : std::next(it);
+    }
+    for (int i = 0; i < 1000; ++i) {
+      list.push_front(-i);
+    }
+    int sum = 0;
+    for (int x : list) {
+      sum += x;
+    }
+    // evens below 3000 minus 0..999
+    ASSERT_TRUE_MSG(list.size() == 2500 && sum == 2248500 - 499500,
+                    "List nodes across chunks")
+
+    std::map<int, std::string, std::less<int>,
+             Allocator<std::pair<const int, std::string>, SmallGrowth>>
+        map;
+    for (int i = 0; i < 2000; ++i) {
+      map[i] = std::to_string(i);
+    }
+    ASSERT_TRUE_MSG(map.size() == 2000 && map[1234] == "1234",
+                    "Map nodes across chunks")
+  }
+
+  // copies and rebound copies share their chunks
+  {
+    auto original = new Allocator<int>();
+    Allocator<double> rebound(*original);
+    Allocator<int> back(rebound);
+    ASSERT_TRUE_MSG(*original == rebound && rebound == back &&
+                        !(back != *original),
+                    "Rebound copies compare equal")
+    ASSERT_TRUE_MSG(Allocator<int>() != *original,
+                    "Independent allocators differ")
+
+    int *block = original->allocate(10);
+    for (int i = 0; i < 10; ++i) {
+      block[i] = i;
+    }
+    back.deallocate(block, 10);
+    // the emptied chunk starts over, so the same block comes back
+    ASSERT_TRUE_MSG(original->allocate(10) == block,
+                    "Memory returned through a rebound copy")
+
+    // the chunks outlive the allocator that created them
+    delete original;
+    int *other = back.allocate(5);
+    other[4] = 7;
+    double *value = rebound.allocate(1);
+    *value = 0.5;
+    ASSERT_TRUE_MSG(other[4] == 7 && *value == 0.5,
+                    "Copies keep the chunks alive")
+    rebound.deallocate(value, 1);
+    back.deallocate(other, 5);
+
+    Allocator<int> assigned;
+    assigned = back;
+    ASSERT_TRUE_MSG(assigned == back, "Assigned allocator joins the group")
+  }
+
+  // requests above the growth cap get their own mapping
+  {
+    using Capped = Allocator<int, GeometricGrowth<16, 64>>;
+    Capped allocator;
+    int *large = allocator.allocate(100000);
+    for (int i = 0; i < 100000; ++i) {
+      large[i] = i;
+    }
+    int *small = allocator.allocate(8);
+    ASSERT_TRUE_MSG(large[99999] == 99999 &&
+                        (small + 8 <= large || large + 100000 <= small),
+                    "Large block outside the chunks")
+    ASSERT_TRUE_MSG(reinterpret_cast<uintptr_t>(large) % getpagesize() == 0,
+                    "Large block is page aligned")
+    allocator.deallocate(large, 100000);
+    allocator.deallocate(small, 8);
+
+    std::vector<int, Capped> vec(100000, 3);
+    ASSERT_TRUE_MSG(vec.back() == 3, "Vector of a large block")
+  }
+
+  // an arena rewinds to a mark and runs the finalizers past it
+  {
+    std::vector<int> log;
+    Arena<GeometricGrowth<256, 4096>> arena;
+    arena.create<Tracked>(log, 1);
+    auto mark = arena.mark();
+    void *afterMark = arena.allocate(32);
+    for (int id = 2; id <= 100; ++id) {
+      arena.create<Tracked>(log, id);
+    }
+    int *trivial = arena.create<int>(5);
+    const size_t capacity = arena.capacity();
+    ASSERT_TRUE_MSG(capacity > 256 && *trivial == 5,
+                    "Arena grows past its first chunk")
+
+    arena.rewind(mark);
+    bool newestFirst = log.size() == 99;
+    for (size_t i = 0; newestFirst && i < log.size(); ++i) {
+      newestFirst = log[i] == static_cast<int>(100 - i);
+    }
+    ASSERT_TRUE_MSG(newestFirst, "Rewind runs finalizers newest first")
+    ASSERT_TRUE_MSG(arena.allocate(32) == afterMark,
+                    "Rewind reuses memory past the mark")
+
+    arena.reset();
+    ASSERT_TRUE_MSG(log.size() == 100 && log.back() == 1,
+                    "Reset runs the remaining finalizers")
+    ASSERT_TRUE_MSG(arena.capacity() == capacity, "Reset keeps the chunks")
+
+    auto aligned = arena.allocateArray<Wide>(3);
+    ASSERT_TRUE_MSG(reinterpret_cast<uintptr_t>(aligned) % alignof(Wide) == 0,
+                    "Arena respects alignment")
+
+    std::vector<int, ArenaAllocator<int, Arena<GeometricGrowth<256, 4096>>>>
+        vec{ArenaAllocator<int, Arena<GeometricGrowth<256, 4096>>>(arena)};
+    for (int i = 0; i < 1000; ++i) {
+      vec.push_back(i);
+    }
+    ASSERT_TRUE_MSG(vec[999] == 999, "Vector on an arena")
+  }
+
+  // pools hand freed slots out again
+  {
+    PoolAllocator<int> pool;
+    int *first = pool.allocate(1);
+    pool.deallocate(first, 1);
+    ASSERT_TRUE_MSG(pool.allocate(1) == first, "Freed slot is reused")
+
+    PoolAllocator<float> rebound(pool);
+    PoolAllocator<int> back(rebound);
+    ASSERT_TRUE_MSG(pool == rebound && back == pool, "Pool copies compare equal")
+    int *second = back.allocate(1);
+    pool.deallocate(second, 1);
+    ASSERT_TRUE_MSG(back.allocate(1) == second,
+                    "Slot returned through a copy is reused")
+
+    std::list<int, PoolAllocator<int>> list;
+    for (int i = 0; i < 1000; ++i) {
+      list.push_back(i);
+    }
+    const int *last = &list.back();
+    list.pop_back();
+    list.push_back(-1);
+    ASSERT_TRUE_MSG(&list.back() == last && list.size() == 1000,
+                    "List node slot is reused")
+
+    PoolAllocator<Wide> wide;
+    Wide *over = wide.allocate(1);
+    Wide *array = wide.allocate(4);
+    ASSERT_TRUE_MSG(reinterpret_cast<uintptr_t>(over) % alignof(Wide) == 0 &&
+                        reinterpret_cast<uintptr_t>(array) % alignof(Wide) ==
+                            0,
+                    "Over-aligned types")
+    wide.deallocate(over, 1);
+    wide.deallocate(array, 4);
+  }
+
+  // statistics are recorded only with -DALLOCATOR_STATS
+  {
+    using Capped = Allocator<int, GeometricGrowth<16, 64>>;
+    Capped allocator;
+    int *a = allocator.allocate(10);
+    int *b = allocator.allocate(10);
+    int *large = allocator.allocate(1000);
+    const AllocatorStats &stats = allocator.getStats();
+    std::ostringstream json;
+    stats.dumpJson(json);
+#ifdef ALLOCATOR_STATS
+    // 10 fits the first chunk of 16, the second 10 needs one of 32
+    ASSERT_TRUE_MSG(stats.chunksCreated() == 2 &&
+                        stats.chunkBytes() == 48 * sizeof(int),
+                    "Chunk counters")
+    ASSERT_TRUE_MSG(stats.bytesInUse() == 20 * sizeof(int) &&
+                        stats.largeBytesInUse() == 1000 * sizeof(int) &&
+                        stats.failedFits() == 1,
+                    "Allocation counters")
+    ASSERT_TRUE_MSG(json.str().find("\"allocations\": 3") != std::string::npos,
+                    "JSON dump")
+#else
+    ASSERT_TRUE_MSG(stats.chunksCreated() == 0 &&
+                        json.str() == "{\"enabled\": false}",
+                    "Statistics disabled")
+#endif
+    allocator.deallocate(large, 1000);
+    allocator.deallocate(b, 10);
+    allocator.deallocate(a, 10);
+#ifdef ALLOCATOR_STATS
+    ASSERT_TRUE_MSG(stats.bytesInUse() == 0 && stats.largeBytesInUse() == 0 &&
+                        stats.peakBytesInUse() == 1020 * sizeof(int) &&
+                        stats.fragmentation() == 1.0,
+                    "Counters after deallocation")
+#endif
+  }
+
+  return 0;
+}
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #define PI 3.14159265
+// relative tolerance of coordinate and length comparisons
+#define EPSILON 1e-6
+
+// query points tested together against each polygon edge, small enough for
+// the points and their winding numbers to stay in L1
+#define POINT_BLOCK 1024
 
 auto square = [](const double &x) -> double {
     return x * x;
@@ -15,37 +25,41 @@ auto radian = [](const double &angle) -> double {
     return PI * angle / 180.0;
 };
 
+// equal up to EPSILON relative to the larger value, or absolute below 1
+auto nearlyEqual = [](const double &a, const double &b) -> bool {
+    return fabs(a - b) <= EPSILON * std::max({1.0, fabs(a), fabs(b)});
+};
+
 class Line;
 
+class Transform;
+
 struct Point {
     double x;
     double y;
 
     Point(const double &x, const double &y) : x(x), y(y) {};
 
-    bool operator==(const Point &other) {
-        return this->x == other.x && this->y == other.y;
+    bool operator==(const Point &other) const {
+        return nearlyEqual(x, other.x) && nearlyEqual(y, other.y);
     }
 
-    bool operator!=(const Point &other) {
+    bool operator!=(const Point &other) const {
         return !(*this == other);
     }
 
-    double distance(const Point &other) {
+    double distance(const Point &other) const {
         return sqrt(square(x - other.x) + square(y - other.y));
     }
 
-    Point(const Point &copy) {
-        x = copy.x;
-        y = copy.y;
-    }
-
     void rotate(const Point &pivot, const double &angle) {
         double shiftedX = x - pivot.x;
         double shiftedY = y - pivot.y;
+        double cosA = cos(radian(angle));
+        double sinA = sin(radian(angle));
 
-        x = pivot.x + (shiftedX * cos(radian(angle)) - shiftedY * sin(radian(angle)));
-        y = pivot.y + (shiftedX * sin(radian(angle)) + shiftedY * cos(radian(angle)));
+        x = pivot.x + (shiftedX * cosA - shiftedY * sinA);
+        y = pivot.y + (shiftedX * sinA + shiftedY * cosA);
     }
 
     void reflex(const Point &pivot) {
@@ -63,59 +77,294 @@ struct Point {
         y = pivot.y + coefficient * shiftedY;
     }
 
-    void operator=(const Point &other) {
-        x = other.x;
-        y = other.y;
-    }
+    void apply(const Transform &transform);
 };
 
 /**
- * y = kx + b
+ * ax + by + c = 0 with a^2 + b^2 = 1, so vertical lines are ordinary and the
+ * signed distance from a point is ax + by + c. The reflection in the line is
+ * kept as the matrix p -> p - 2 (ax + by + c)(a, b), so reflecting points
+ * takes no divisions.
  */
 class Line {
+public:
+    // m00, m01, m10, m11, tx, ty, in the layout of Transform::Matrix
+    using Mirror = double[6];
+
 private:
-    double k_;
+    double a_;
     double b_;
+    double c_;
+    Mirror mirror_;
+
+    void normalize() {
+        double norm = sqrt(square(a_) + square(b_));
+        a_ /= norm;
+        b_ /= norm;
+        c_ /= norm;
+        mirror_[0] = 1.0 - 2.0 * a_ * a_;
+        mirror_[1] = -2.0 * a_ * b_;
+        mirror_[2] = mirror_[1];
+        mirror_[3] = 1.0 - 2.0 * b_ * b_;
+        mirror_[4] = -2.0 * a_ * c_;
+        mirror_[5] = -2.0 * b_ * c_;
+    }
 
 public:
-    Line(const double &k, const double &b) : k_(k), b_(b) {}
-
-    Line(const Point &p1, const Point &p2) {
-        k_ = (p2.y - p1.y) / (p2.x - p1.x);
-        b_ = p1.y - k_ * p1.x;
+    // ax + by + c = 0; (a, b) must not be zero
+    Line(const double &a, const double &b, const double &c) : a_(a), b_(b), c_(c) {
+        normalize();
     }
 
-    Line(const Point &p, const double &k) {
-        this->k_ = k;
-        this->b_ = p.y - k * p.x;
-    }
+    // y = kx + b
+    Line(const double &k, const double &b) : Line(k, -1.0, b) {}
+
+    Line(const Point &p1, const Point &p2)
+            : Line(p1.y - p2.y, p2.x - p1.x, p1.x * p2.y - p2.x * p1.y) {}
+
+    Line(const Point &p, const double &k) : Line(k, -1.0, p.y - k * p.x) {}
 
+    // slope and intercept of y = kx + b; not finite for vertical lines
     double k() const {
-        return k_;
+        return -a_ / b_;
     }
 
     double b() const {
-        return b_;
+        return -c_ / b_;
+    }
+
+    // unit normal (a, b)
+    Point normal() const {
+        return Point(a_, b_);
+    }
+
+    double offset() const {
+        return c_;
+    }
+
+    const Mirror &mirror() const {
+        return mirror_;
+    }
+
+    // positive on the side the normal points to
+    double signedDistance(const Point &p) const {
+        return a_ * p.x + b_ * p.y + c_;
+    }
+
+    // out[i] = signedDistance(points[i])
+    void signedDistances(const Point *points, size_t count, double *out) const {
+        const double a = a_;
+        const double b = b_;
+        const double c = c_;
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = a * points[i].x + b * points[i].y + c;
+        }
+    }
+
+    // out[i] is points[i] reflected in the line; out may be points
+    void reflect(const Point *points, size_t count, Point *out) const {
+        const Mirror &m = mirror_;
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; ++i) {
+            double x = points[i].x;
+            double y = points[i].y;
+            out[i].x = m[0] * x + m[1] * y + m[4];
+            out[i].y = m[2] * x + m[3] * y + m[5];
+        }
     }
 
-    bool operator==(const Line &other) {
-        return this->k_ == other.k_ && this->b_ == other.b_;
+    // coordinates are not finite if the lines are parallel
+    Point intersection(const Line &other) const {
+        double det = a_ * other.b_ - b_ * other.a_;
+        return Point((b_ * other.c_ - c_ * other.b_) / det, (c_ * other.a_ - a_ * other.c_) / det);
     }
 
-    bool operator!=(const Line &other) {
+    // out[i] = intersection(lines[i])
+    void intersect(const Line *lines, size_t count, Point *out) const {
+        const double a = a_;
+        const double b = b_;
+        const double c = c_;
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; ++i) {
+            double det = a * lines[i].b_ - b * lines[i].a_;
+            out[i].x = (b * lines[i].c_ - c * lines[i].b_) / det;
+            out[i].y = (c * lines[i].a_ - a * lines[i].c_) / det;
+        }
+    }
+
+    // (a, b, c) and (-a, -b, -c) are the same line
+    bool operator==(const Line &other) const {
+        return (nearlyEqual(a_, other.a_) && nearlyEqual(b_, other.b_) && nearlyEqual(c_, other.c_)) ||
+               (nearlyEqual(a_, -other.a_) && nearlyEqual(b_, -other.b_) && nearlyEqual(c_, -other.c_));
+    }
+
+    bool operator!=(const Line &other) const {
         return !(*this == other);
     }
 };
 
 void Point::reflex(const Line &line) {
-    double xRefl =
-            ((1 - square(line.k())) * x + 2.0 * line.k() * y - 2.0 * line.k() * line.b()) / (square(line.k()) + 1);
-    double yRefl = ((square(line.k()) - 1) * y + 2.0 * line.k() * x + 2.0 * line.b()) / (square(line.k()) + 1);
+    const Line::Mirror &m = line.mirror();
+    double xRefl = m[0] * x + m[1] * y + m[4];
+    double yRefl = m[2] * x + m[3] * y + m[5];
 
     x = xRefl;
     y = yRefl;
 }
 
+/**
+ * Similarity transform of the plane as a 2x3 matrix:
+ * p -> (m00 x + m01 y + tx, m10 x + m11 y + ty).
+ * Transforms are built from rotations, reflections and scalings and chained
+ * with then(), so a sequence of operations costs one matrix product each and
+ * a single pass over the points. Angles are in degrees, as in rotate().
+ */
+class Transform {
+public:
+    using Matrix = double[6];
+
+private:
+    // m00, m01, m10, m11, tx, ty
+    Matrix m;
+    // lengths are multiplied by this, areas by its square
+    double factor;
+
+    Transform(double m00, double m01, double m10, double m11, double tx, double ty, double factor)
+            : m{m00, m01, m10, m11, tx, ty}, factor(factor) {}
+
+public:
+    Transform() : Transform(1.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.0) {}
+
+    static Transform rotation(const Point &pivot, const double &angle) {
+        double cosA = cos(radian(angle));
+        double sinA = sin(radian(angle));
+        return Transform(cosA, -sinA, sinA, cosA,
+                         pivot.x - cosA * pivot.x + sinA * pivot.y,
+                         pivot.y - sinA * pivot.x - cosA * pivot.y, 1.0);
+    }
+
+    static Transform reflection(const Point &pivot) {
+        return Transform(-1.0, 0.0, 0.0, -1.0, 2.0 * pivot.x, 2.0 * pivot.y, 1.0);
+    }
+
+    static Transform reflection(const Line &line) {
+        const Line::Mirror &r = line.mirror();
+        return Transform(r[0], r[1], r[2], r[3], r[4], r[5], 1.0);
+    }
+
+    static Transform scaling(const Point &pivot, const double &coefficient) {
+        return Transform(coefficient, 0.0, 0.0, coefficient,
+                         pivot.x * (1 - coefficient), pivot.y * (1 - coefficient), fabs(coefficient));
+    }
+
+    // this transform followed by next
+    Transform then(const Transform &next) const {
+        const Matrix &n = next.m;
+        return Transform(n[0] * m[0] + n[1] * m[2], n[0] * m[1] + n[1] * m[3],
+                         n[2] * m[0] + n[3] * m[2], n[2] * m[1] + n[3] * m[3],
+                         n[0] * m[4] + n[1] * m[5] + n[4], n[2] * m[4] + n[3] * m[5] + n[5],
+                         factor * next.factor);
+    }
+
+    Point operator()(const Point &p) const {
+        return Point(m[0] * p.x + m[1] * p.y + m[4], m[2] * p.x + m[3] * p.y + m[5]);
+    }
+
+    const Matrix &coefficients() const {
+        return m;
+    }
+
+    double lengthFactor() const {
+        return factor;
+    }
+
+    // true for transforms that map horizontal and vertical lines to themselves
+    bool keepsAxes() const {
+        return m[1] == 0.0 && m[2] == 0.0;
+    }
+
+    // true for transforms that mirror the plane
+    bool reverses() const {
+        return m[0] * m[3] - m[1] * m[2] < 0.0;
+    }
+};
+
+void Point::apply(const Transform &transform) {
+    *this = transform(*this);
+}
+
+/**
+ * Axis-aligned bounding box. empty() contains nothing and grows to the first
+ * point or box it is extended with.
+ */
+struct BoundingBox {
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+
+    static BoundingBox empty() {
+        const double inf = std::numeric_limits<double>::infinity();
+        return BoundingBox{inf, inf, -inf, -inf};
+    }
+
+    void extend(const Point &p) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
+    }
+
+    void extend(const BoundingBox &other) {
+        minX = std::min(minX, other.minX);
+        minY = std::min(minY, other.minY);
+        maxX = std::max(maxX, other.maxX);
+        maxY = std::max(maxY, other.maxY);
+    }
+
+    BoundingBox merged(const BoundingBox &other) const {
+        BoundingBox res = *this;
+        res.extend(other);
+        return res;
+    }
+
+    bool contains(const Point &p) const {
+        return minX <= p.x && p.x <= maxX && minY <= p.y && p.y <= maxY;
+    }
+
+    bool contains(const BoundingBox &other) const {
+        return minX <= other.minX && other.maxX <= maxX && minY <= other.minY && other.maxY <= maxY;
+    }
+
+    bool intersects(const BoundingBox &other) const {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+
+    double area() const {
+        return (maxX - minX) * (maxY - minY);
+    }
+
+    Point center() const {
+        return Point((minX + maxX) / 2.0, (minY + maxY) / 2.0);
+    }
+
+    // the box of the image under a transform that keeps the axes
+    BoundingBox mapped(const Transform &transform) const {
+        BoundingBox res = empty();
+        res.extend(transform(Point(minX, minY)));
+        res.extend(transform(Point(maxX, maxY)));
+        return res;
+    }
+
+    // squared distance from p to the box, 0 inside
+    double distance2(const Point &p) const {
+        double dx = std::max({minX - p.x, 0.0, p.x - maxX});
+        double dy = std::max({minY - p.y, 0.0, p.y - maxY});
+        return dx * dx + dy * dy;
+    }
+};
+
 class Shape {
 public:
     virtual double perimeter() const = 0;
@@ -126,6 +375,12 @@ public:
 
     virtual bool operator!=(const Shape& other) const = 0;
 
+    // the shapes can be mapped onto each other by rotations, reflections and shifts
+    virtual bool isCongruentTo(const Shape &other) const = 0;
+
+    // the same, with scaling allowed too
+    virtual bool isSimilarTo(const Shape &other) const = 0;
+
     virtual void rotate(const Point &pivot, const double &angle) = 0;
 
     virtual void reflex(const Point &pivot) = 0;
@@ -134,6 +389,24 @@ public:
 
     virtual void scale(const Point &pivot, const double &coefficient) = 0;
 
+    // applies a composed transform in one pass
+    virtual void apply(const Transform &transform) = 0;
+
+    virtual BoundingBox boundingBox() const = 0;
+
+    // center of mass of the area
+    virtual Point centroid() const = 0;
+
+    virtual bool containsPoint(const Point &p) const = 0;
+
+    // out[i] is 1 if points[i] lies inside the shape and 0 otherwise
+    virtual void containsPoints(const Point *points, size_t count, char *out) const = 0;
+
+    void containsPoints(const std::vector<Point> &points, std::vector<char> &out) const {
+        out.resize(points.size());
+        containsPoints(points.data(), points.size(), out.data());
+    }
+
     virtual ~Shape() = 0;
 };
 
@@ -141,109 +414,426 @@ Shape::~Shape() = default;
 
 class Polygon : virtual public Shape {
 private:
-    std::vector<Point> *vertices;
-    size_t vNum;
+    std::vector<Point> vertices;
+
+    // an edge as a fraction of the perimeter and the turn at its end
+    struct Corner {
+        double length;
+        double cosine;
+        double sine;
+
+        bool operator==(const Corner &other) const {
+            return fabs(length - other.length) <= EPSILON && fabs(cosine - other.cosine) <= EPSILON &&
+                   fabs(sine - other.sine) <= EPSILON;
+        }
+    };
+
+    /**
+     * The boundary walked counterclockwise as a cyclic sequence of corners,
+     * for the polygon and for its mirror image. Both are unchanged by
+     * rotations, shifts and scalings and swap places under reflections, so
+     * the two polygons are similar if one sequence is a cyclic shift of
+     * either of the other's. Built on first use; not safe to build from
+     * several threads at once.
+     */
+    struct Outline {
+        bool built = false;
+        std::vector<Corner> direct;
+        std::vector<Corner> mirrored;
+    };
+
+    mutable Outline outline;
+
+    // measures computed on first use and carried through apply(); similarity
+    // transforms scale area and perimeter and map the centroid exactly
+    struct Measures {
+        std::optional<double> area;
+        std::optional<double> perimeter;
+        std::optional<Point> centroid;
+        std::optional<BoundingBox> box;
+    };
+
+    mutable Measures measures;
+
+    /**
+     * Vertices where the boundary goes straight on are merged into one edge.
+     * Vertices closer than EPSILON of the bounding box diagonal are merged
+     * into one point, so the tolerance follows the polygon's own size and not
+     * its distance from the origin.
+     */
+    static std::vector<Corner> corners(const std::vector<Point> &vertices, bool mirror) {
+        double minX = vertices[0].x, maxX = vertices[0].x;
+        double minY = vertices[0].y, maxY = vertices[0].y;
+        for (const Point &p : vertices) {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        const double merge = EPSILON * std::hypot(maxX - minX, maxY - minY);
+        auto same = [merge](const Point &a, const Point &b) {
+            return a.distance(b) <= merge;
+        };
+
+        double orientation = 0.0;
+        for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            orientation += (vertices[j].x - vertices[i].x) * (vertices[j].y + vertices[i].y);
+        }
+        const bool backward = (orientation < 0.0) != mirror;
+        std::vector<Point> walk;
+        walk.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            Point p = vertices[backward ? vertices.size() - 1 - i : i];
+            if (mirror) {
+                p.x = -p.x;
+            }
+            if (walk.empty() || !same(p, walk.back())) {
+                walk.push_back(p);
+            }
+        }
+        while (walk.size() > 1 && same(walk.front(), walk.back())) {
+            walk.pop_back();
+        }
+        const size_t n = walk.size();
+        if (n < 3) {
+            return {};
+        }
+
+        std::vector<Corner> raw(n);
+        double perimeter = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const Point &a = walk[i];
+            const Point &b = walk[(i + 1) % n];
+            const Point &c = walk[(i + 2) % n];
+            double length = a.distance(b);
+            double next = b.distance(c);
+            double dot = (b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y);
+            double cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+            raw[i] = Corner{length, dot / (length * next), cross / (length * next)};
+            perimeter += length;
+        }
+
+        auto straight = [](const Corner &corner) {
+            return fabs(corner.sine) <= EPSILON && corner.cosine > 0.0;
+        };
+        size_t start = 0;
+        while (start < n && straight(raw[start])) {
+            ++start;
+        }
+        if (start == n) {
+            return {};
+        }
+        std::vector<Corner> result;
+        double length = 0.0;
+        for (size_t k = 1; k <= n; ++k) {
+            const Corner &corner = raw[(start + k) % n];
+            length += corner.length;
+            if (!straight(corner)) {
+                result.push_back(Corner{length / perimeter, corner.cosine, corner.sine});
+                length = 0.0;
+            }
+        }
+        return result;
+    }
+
+    const Outline &getOutline() const {
+        if (!outline.built) {
+            outline.direct = corners(vertices, false);
+            outline.mirrored = corners(vertices, true);
+            outline.built = true;
+        }
+        return outline;
+    }
+
+    /**
+     * Whether pattern occurs in text read cyclically. Corner == is tolerant
+     * and so not transitive, which a string search such as Knuth-Morris-Pratt
+     * relies on when it skips shifts; every shift whose first corner matches
+     * is confirmed directly instead. An empty outline, left by a polygon with
+     * no area, is similar to nothing.
+     */
+    static bool cyclicShift(const std::vector<Corner> &text, const std::vector<Corner> &pattern) {
+        const size_t n = pattern.size();
+        if (text.size() != n || n == 0) {
+            return false;
+        }
+        for (size_t shift = 0; shift < n; ++shift) {
+            size_t i = 0;
+            while (i < n && text[(shift + i) % n] == pattern[i]) {
+                ++i;
+            }
+            if (i == n) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // contribution of edge from -> to to the winding number of (x, y): +1 if
+    // it goes up past the point with the point on its left, -1 if it goes down
+    // with the point on its right. Counted in doubles, which are exact for
+    // these integers and let the compiler turn the selects into vector masks
+    static double crossing(const Point &from, const Point &to, const double &x, const double &y) {
+        double side = (to.x - from.x) * (y - from.y) - (x - from.x) * (to.y - from.y);
+        double upward = from.y <= y && y < to.y && side > 0.0 ? 1.0 : 0.0;
+        double downward = to.y <= y && y < from.y && side < 0.0 ? 1.0 : 0.0;
+        return upward - downward;
+    }
+
 public:
-    explicit Polygon(const std::vector<Point> &vertices) {
-        this->vertices = new std::vector<Point>(vertices);
-        this->vNum = this->vertices->size();
+    // every measure and test below relies on having at least three vertices
+    explicit Polygon(std::vector<Point> vertices) : vertices(std::move(vertices)) {
+        if (this->vertices.size() < 3) {
+            throw std::invalid_argument("Polygon needs at least 3 vertices!");
+        }
     }
 
     size_t verticesCount() const {
-        return vNum;
+        return vertices.size();
     }
 
-    std::vector<Point> getVertices() const {
-        return *vertices;
+    const std::vector<Point> &getVertices() const {
+        return vertices;
     }
 
     double perimeter() const override {
-        double sum = 0.0;
-        for (size_t i = 1; i < vNum; ++i) {
-            sum = (*vertices)[i].distance((*vertices)[i - 1]);
+        if (!measures.perimeter) {
+            double sum = 0.0;
+            for (size_t i = 1; i < vertices.size(); ++i) {
+                sum += vertices[i].distance(vertices[i - 1]);
+            }
+            sum += vertices[0].distance(vertices.back());
+            measures.perimeter = sum;
         }
-        sum += (*vertices)[0].distance((*vertices)[vNum - 1]);
-        return sum;
+        return *measures.perimeter;
     }
 
     double area() const  override {
-        double area = 0.0;
-        for (size_t i = 1; i < vNum; ++i) {
-            area += ((*vertices)[i].x + (*vertices)[i - 1].x) * ((*vertices)[i].y - (*vertices)[i - 1].y);
+        if (!measures.area) {
+            double area = 0.0;
+            for (size_t i = 1; i < vertices.size(); ++i) {
+                area += (vertices[i].x + vertices[i - 1].x) * (vertices[i].y - vertices[i - 1].y);
+            }
+            area += (vertices[0].x + vertices.back().x) * (vertices[0].y - vertices.back().y);
+            measures.area = fabs(area) / 2.0;
         }
-        area += ((*vertices)[0].x + (*vertices)[vNum - 1].x) * ((*vertices)[0].y - (*vertices)[vNum - 1].y);
-        return fabs(area) / 2.0;
+        return *measures.area;
     }
 
-    void rotate(const Point &pivot, const double &angle) override {
-        for (auto vertex : *vertices) {
-            vertex.rotate(pivot, angle);
+    // the mean of the vertices if the area is zero
+    Point centroid() const override {
+        if (!measures.centroid) {
+            double doubleArea = 0.0;
+            double x = 0.0;
+            double y = 0.0;
+            for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+                double cross = vertices[j].x * vertices[i].y - vertices[i].x * vertices[j].y;
+                doubleArea += cross;
+                x += (vertices[j].x + vertices[i].x) * cross;
+                y += (vertices[j].y + vertices[i].y) * cross;
+            }
+            if (doubleArea != 0.0) {
+                measures.centroid = Point(x / (3.0 * doubleArea), y / (3.0 * doubleArea));
+            } else {
+                x = 0.0;
+                y = 0.0;
+                for (const Point &vertex : vertices) {
+                    x += vertex.x;
+                    y += vertex.y;
+                }
+                measures.centroid = Point(x / vertices.size(), y / vertices.size());
+            }
         }
+        return *measures.centroid;
+    }
+
+    void rotate(const Point &pivot, const double &angle) override {
+        apply(Transform::rotation(pivot, angle));
     }
 
     void reflex(const Point &pivot) override {
-        for(auto vertex : *vertices) {
-            vertex.reflex(pivot);
-        }
+        apply(Transform::reflection(pivot));
     }
 
     void reflex(const Line& line) override {
-        for(auto vertex : *vertices) {
-            vertex.reflex(line);
-        }
+        apply(Transform::reflection(line));
     }
 
     void scale(const Point& pivot, const double& coefficient) override {
-        for(auto vertex : *vertices) {
-            vertex.scale(pivot, coefficient);
+        apply(Transform::scaling(pivot, coefficient));
+    }
+
+    void apply(const Transform &transform) override {
+        const Transform::Matrix &m = transform.coefficients();
+        Point *vertex = vertices.data();
+#pragma GCC ivdep
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            double x = vertex[i].x;
+            double y = vertex[i].y;
+            vertex[i].x = m[0] * x + m[1] * y + m[4];
+            vertex[i].y = m[2] * x + m[3] * y + m[5];
+        }
+        if (transform.reverses()) {
+            std::swap(outline.direct, outline.mirrored);
+        }
+        const double factor = transform.lengthFactor();
+        if (measures.area) {
+            *measures.area *= square(factor);
+        }
+        if (measures.perimeter) {
+            *measures.perimeter *= factor;
+        }
+        if (measures.centroid) {
+            measures.centroid = transform(*measures.centroid);
+        }
+        if (measures.box && transform.keepsAxes()) {
+            measures.box = measures.box->mapped(transform);
+        } else {
+            measures.box.reset();
         }
     }
 
+    BoundingBox boundingBox() const override {
+        if (!measures.box) {
+            BoundingBox box = BoundingBox::empty();
+            for (const Point &vertex : vertices) {
+                box.extend(vertex);
+            }
+            measures.box = box;
+        }
+        return *measures.box;
+    }
+
+    using Shape::containsPoints;
+
+    // nonzero winding number; points exactly on an edge may go either way
+    bool containsPoint(const Point &p) const override {
+        const Point *vertex = vertices.data();
+        const size_t n = vertices.size();
+        double winding = crossing(vertex[n - 1], vertex[0], p.x, p.y);
+        for (size_t i = 1; i < n; ++i) {
+            winding += crossing(vertex[i - 1], vertex[i], p.x, p.y);
+        }
+        return winding != 0;
+    }
+
+    // points are taken in blocks of POINT_BLOCK and every edge is swept over a
+    // block at once, so the inner loop runs across points and each point is
+    // read from memory once
+    void containsPoints(const Point *points, size_t count, char *out) const override {
+        const Point *vertex = vertices.data();
+        const size_t n = vertices.size();
+        double winding[POINT_BLOCK];
+        for (size_t begin = 0; begin < count; begin += POINT_BLOCK) {
+            const Point *block = points + begin;
+            const size_t size = std::min<size_t>(POINT_BLOCK, count - begin);
+            std::fill(winding, winding + size, 0.0);
+            for (size_t e = 0; e < n; ++e) {
+                const Point &from = vertex[e == 0 ? n - 1 : e - 1];
+                const Point &to = vertex[e];
+#pragma GCC ivdep
+                for (size_t i = 0; i < size; ++i) {
+                    winding[i] += crossing(from, to, block[i].x, block[i].y);
+                }
+            }
+            for (size_t i = 0; i < size; ++i) {
+                out[begin + i] = winding[i] != 0;
+            }
+        }
+    }
+
+    // the same vertices in the same cyclic order, in either direction
     bool operator==(const Shape &other) const override {
-        auto p = dynamic_cast<const Polygon*>(& other);
-        return this->vNum == p->vNum && this->area() == p->area() && this->perimeter() == p->perimeter();
+        auto p = dynamic_cast<const Polygon *>(&other);
+        if (p == nullptr || p->vertices.size() != vertices.size()) {
+            return false;
+        }
+        const std::vector<Point> &theirs = p->vertices;
+        const size_t n = vertices.size();
+        for (size_t shift = 0; shift < n; ++shift) {
+            if (theirs[shift] != vertices[0]) {
+                continue;
+            }
+            bool forward = true;
+            bool backward = true;
+            for (size_t i = 1; i < n && (forward || backward); ++i) {
+                forward = forward && theirs[(shift + i) % n] == vertices[i];
+                backward = backward && theirs[(shift + n - i) % n] == vertices[i];
+            }
+            if (forward || backward) {
+                return true;
+            }
+        }
+        return false;
     }
 
     bool operator!=(const Shape& other) const override {
         return !(*this == other);
     }
 
-    ~Polygon() override {
-        delete vertices;
+    bool isCongruentTo(const Shape &other) const override {
+        auto p = dynamic_cast<const Polygon *>(&other);
+        // relative even below 1: tiny polygons of different sizes are not congruent
+        return p != nullptr && fabs(perimeter() - p->perimeter()) <= EPSILON * std::max(perimeter(), p->perimeter()) &&
+               isSimilarTo(other);
+    }
+
+    bool isSimilarTo(const Shape &other) const override {
+        auto p = dynamic_cast<const Polygon *>(&other);
+        if (p == nullptr) {
+            return false;
+        }
+        const Outline &mine = getOutline();
+        const Outline &theirs = p->getOutline();
+        return cyclicShift(mine.direct, theirs.direct) || cyclicShift(mine.direct, theirs.mirrored);
     }
 };
 
 class Ellipse : virtual public Shape {
-private:
-    Point *focus1;
-    Point *focus2;
+protected:
+    Point focus1;
+    Point focus2;
     double a;
     double b;
     double c;
 
+    // the perimeter takes an elliptic integral and the box two square roots,
+    // so both are kept; apply() rescales the perimeter
+    mutable std::optional<double> cachedPerimeter;
+    mutable std::optional<BoundingBox> cachedBox;
+
 public:
-    Ellipse(const Point &p1, const Point &p2, const double &distSum) {
-        focus1 = new Point(p1);
-        focus2 = new Point(p2);
+    Ellipse(const Point &p1, const Point &p2, const double &distSum) : focus1(p1), focus2(p2) {
         a = distSum / 2.0;
-        c = focus1->distance(*focus2) / 2.0;
+        c = focus1.distance(focus2) / 2.0;
         b = sqrt(square(a) - square(c));
     }
 
-    std::pair<Point, Point> focuses() {
-        return std::make_pair(*focus1, *focus2);
+    std::pair<Point, Point> focuses() const {
+        return std::make_pair(focus1, focus2);
     }
 
-    Point center() {
-        return Point((focus1->x + focus2->x) / 2.0, (focus1->y + focus2->y) / 2.0);
+    Point center() const {
+        return Point((focus1.x + focus2.x) / 2.0, (focus1.y + focus2.y) / 2.0);
     }
 
-    double eccentricity() {
+    double eccentricity() const {
         return c / a;
     }
 
+    double semiMajorAxis() const {
+        return a;
+    }
+
+    double semiMinorAxis() const {
+        return b;
+    }
+
     double perimeter() const override {
-        return 4 * a * std::comp_ellint_2(sqrt(square(a) - square(b)) / a);
+        if (!cachedPerimeter) {
+            cachedPerimeter = 4 * a * std::comp_ellint_2(sqrt(square(a) - square(b)) / a);
+        }
+        return *cachedPerimeter;
     }
 
     double area() const override {
@@ -251,93 +841,241 @@ public:
     }
 
     void rotate(const Point &pivot, const double &angle) override {
-        focus1->rotate(pivot, angle);
-        focus2->rotate(pivot, angle);
+        apply(Transform::rotation(pivot, angle));
     }
 
     void reflex(const Point &pivot) override {
-        focus1->reflex(pivot);
-        focus2->reflex(pivot);
+        apply(Transform::reflection(pivot));
     }
 
     void reflex(const Line &line) override {
-        focus1->reflex(line);
-        focus2->reflex(line);
+        apply(Transform::reflection(line));
     }
 
     void scale(const Point &pivot, const double &coefficient) override {
-        focus1->scale(pivot, coefficient);
-        focus2->scale(pivot, coefficient);
-        a *= coefficient;
-        b *= coefficient;
-        c *= coefficient;
+        apply(Transform::scaling(pivot, coefficient));
+    }
+
+    void apply(const Transform &transform) override {
+        focus1.apply(transform);
+        focus2.apply(transform);
+        a *= transform.lengthFactor();
+        b *= transform.lengthFactor();
+        c *= transform.lengthFactor();
+        if (cachedPerimeter) {
+            *cachedPerimeter *= transform.lengthFactor();
+        }
+        if (cachedBox && transform.keepsAxes()) {
+            cachedBox = cachedBox->mapped(transform);
+        } else {
+            cachedBox.reset();
+        }
+    }
+
+    // extent of an ellipse with semi-axes a, b along the focal direction u is
+    // sqrt(a^2 ux^2 + b^2 uy^2) in x and sqrt(a^2 uy^2 + b^2 ux^2) in y
+    BoundingBox boundingBox() const override {
+        if (!cachedBox) {
+            double distance = focus1.distance(focus2);
+            double ux = distance > 0.0 ? (focus2.x - focus1.x) / distance : 1.0;
+            double uy = distance > 0.0 ? (focus2.y - focus1.y) / distance : 0.0;
+            double halfWidth = sqrt(square(a * ux) + square(b * uy));
+            double halfHeight = sqrt(square(a * uy) + square(b * ux));
+            Point middle = center();
+            cachedBox = BoundingBox{middle.x - halfWidth, middle.y - halfHeight,
+                                    middle.x + halfWidth, middle.y + halfHeight};
+        }
+        return *cachedBox;
+    }
+
+    Point centroid() const override {
+        return center();
+    }
+
+    using Shape::containsPoints;
+
+    // the sum of distances to the foci is at most 2a, boundary included
+    bool containsPoint(const Point &p) const override {
+        return p.distance(focus1) + p.distance(focus2) <= 2.0 * a;
+    }
+
+    void containsPoints(const Point *points, size_t count, char *out) const override {
+        const Point f1 = focus1;
+        const Point f2 = focus2;
+        const double sum = 2.0 * a;
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; ++i) {
+            double d1 = sqrt(square(points[i].x - f1.x) + square(points[i].y - f1.y));
+            double d2 = sqrt(square(points[i].x - f2.x) + square(points[i].y - f2.y));
+            out[i] = d1 + d2 <= sum;
+        }
     }
 
+    // the same foci, in any order, and the same axes
     bool operator==(const Shape &other) const override {
         auto e = dynamic_cast<const Ellipse *>(&other);
-        return this->a == e->a && this->b == e->b && this->c == e->c;
+        if (e == nullptr || !nearlyEqual(a, e->a)) {
+            return false;
+        }
+        return (focus1 == e->focus1 && focus2 == e->focus2) || (focus1 == e->focus2 && focus2 == e->focus1);
     }
 
     bool operator!=(const Shape& other) const override {
         return !(*this == other);
     }
 
-    ~Ellipse() override {
-        delete focus1;
-        delete focus2;
+    bool isCongruentTo(const Shape &other) const override {
+        auto e = dynamic_cast<const Ellipse *>(&other);
+        return e != nullptr && nearlyEqual(a, e->a) && nearlyEqual(b, e->b);
+    }
+
+    bool isSimilarTo(const Shape &other) const override {
+        auto e = dynamic_cast<const Ellipse *>(&other);
+        return e != nullptr && fabs(eccentricity() - e->eccentricity()) <= EPSILON;
     }
 };
 
+/**
+ * Both foci of a circle are its center, so the center and the radius (a) are
+ * kept, transformed and compared by Ellipse; a circle equals an ellipse
+ * with coinciding foci.
+ */
 class Circle : public Ellipse {
-private:
-    Point *center_;
-    double radius_;
-
 public:
-    Circle(const Point &p, double radius) : Ellipse(p, p, radius * 2.0) {
-        center_ = new Point(p);
-        radius_ = radius;
-    }
+    Circle(const Point &p, double radius) : Ellipse(p, p, radius * 2.0) {}
 
-    double radius() {
-        return radius_;
+    double radius() const {
+        return a;
     }
 
     double perimeter() const override {
-        return 2 * PI * radius_;
+        return 2 * PI * a;
     }
 
     double area() const override {
-        return PI * square(radius_);
+        return PI * square(a);
     }
 
-    void rotate(const Point &pivot, const double &angle) override {
-        center_->rotate(pivot, angle);
+    using Shape::containsPoints;
+
+    // compares squared distances, so no square roots are taken
+    bool containsPoint(const Point &p) const override {
+        return square(p.x - focus1.x) + square(p.y - focus1.y) <= square(a);
     }
 
-    void reflex(const Point &pivot) override {
-        center_->reflex(pivot);
+    void containsPoints(const Point *points, size_t count, char *out) const override {
+        const Point center = focus1;
+        const double radius2 = square(a);
+#pragma GCC ivdep
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = square(points[i].x - center.x) + square(points[i].y - center.y) <= radius2;
+        }
     }
+};
 
-    void reflex(const Line &line) override {
-        center_->reflex(line);
+/**
+ * Of the two rectangles with the given diagonal and side ratio, the one with
+ * the shorter side from the first point on the left of the diagonal. The
+ * ratio may be given either way round.
+ */
+class Rectangle : public Polygon {
+private:
+    static std::vector<Point> vertices(const Point &from, const Point &to, double ratio) {
+        if (ratio > 1.0) {
+            ratio = 1.0 / ratio;
+        }
+        // the shorter side makes an angle with cosine ratio / sqrt(1 + ratio^2)
+        // with the diagonal
+        double cosA = ratio / sqrt(1.0 + square(ratio));
+        double sinA = 1.0 / sqrt(1.0 + square(ratio));
+        double dx = to.x - from.x;
+        double dy = to.y - from.y;
+        Point corner(from.x + cosA * (cosA * dx - sinA * dy), from.y + cosA * (sinA * dx + cosA * dy));
+        Point opposite(from.x + to.x - corner.x, from.y + to.y - corner.y);
+        return {from, corner, to, opposite};
     }
 
-    void scale(const Point &pivot, const double &coefficient) override {
-        center_->scale(pivot, coefficient);
-        radius_ *= coefficient;
+public:
+    Rectangle(const Point &from, const Point &to, const double &ratio)
+            : Polygon(vertices(from, to, ratio)) {}
+
+    Point center() const {
+        const std::vector<Point> &v = getVertices();
+        return Point((v[0].x + v[2].x) / 2.0, (v[0].y + v[2].y) / 2.0);
     }
 
-    bool operator==(const Shape &other) const override {
-        auto c = dynamic_cast<const Circle *>(&other);
-        return center_ == c->center_ && radius_ == c->radius_;
+    std::pair<Line, Line> diagonals() const {
+        const std::vector<Point> &v = getVertices();
+        return std::make_pair(Line(v[0], v[2]), Line(v[1], v[3]));
     }
+};
 
-    bool operator!=(const Shape& other) const override {
-        return !(*this == other);
+class Square : public Rectangle {
+public:
+    Square(const Point &from, const Point &to) : Rectangle(from, to, 1.0) {}
+
+    Circle circumscribedCircle() const {
+        const std::vector<Point> &v = getVertices();
+        return Circle(center(), v[0].distance(v[2]) / 2.0);
     }
 
-    ~Circle() override {
-        delete center_;
+    Circle inscribedCircle() const {
+        const std::vector<Point> &v = getVertices();
+        return Circle(center(), v[0].distance(v[1]) / 2.0);
     }
-};
\ No newline at end of file
+};
+
+class Triangle : public Polygon {
+public:
+    Triangle(const Point &p1, const Point &p2, const Point &p3) : Polygon({p1, p2, p3}) {}
+
+    Circle circumscribedCircle() const {
+        Point center = circumcenter();
+        return Circle(center, center.distance(getVertices()[0]));
+    }
+
+    // the center weighs each vertex by the length of the opposite side
+    Circle inscribedCircle() const {
+        const std::vector<Point> &v = getVertices();
+        double a = v[1].distance(v[2]);
+        double b = v[2].distance(v[0]);
+        double c = v[0].distance(v[1]);
+        double sum = a + b + c;
+        Point center((a * v[0].x + b * v[1].x + c * v[2].x) / sum, (a * v[0].y + b * v[1].y + c * v[2].y) / sum);
+        return Circle(center, 2.0 * area() / sum);
+    }
+
+    // H = A + B + C - 2 O, with O the circumcenter
+    Point orthocenter() const {
+        const std::vector<Point> &v = getVertices();
+        Point center = circumcenter();
+        return Point(v[0].x + v[1].x + v[2].x - 2.0 * center.x, v[0].y + v[1].y + v[2].y - 2.0 * center.y);
+    }
+
+    // not defined for an equilateral triangle, where all the centers coincide
+    Line EulerLine() const {
+        return Line(circumcenter(), orthocenter());
+    }
+
+    // centered halfway between the circumcenter and the orthocenter, with
+    // half the circumradius
+    Circle ninePointsCircle() const {
+        Circle circumcircle = circumscribedCircle();
+        Point center = circumcircle.center();
+        Point orc = orthocenter();
+        return Circle(Point((center.x + orc.x) / 2.0, (center.y + orc.y) / 2.0), circumcircle.radius() / 2.0);
+    }
+
+private:
+    Point circumcenter() const {
+        const std::vector<Point> &v = getVertices();
+        double bx = v[1].x - v[0].x;
+        double by = v[1].y - v[0].y;
+        double cx = v[2].x - v[0].x;
+        double cy = v[2].y - v[0].y;
+        double d = 2.0 * (bx * cy - by * cx);
+        double b2 = square(bx) + square(by);
+        double c2 = square(cx) + square(cy);
+        return Point(v[0].x + (cy * b2 - by * c2) / d, v[0].y + (bx * c2 - cx * b2) / d);
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// ranges smaller than this are processed on the calling thread
+#define PARALLEL_GRAIN (1u << 16)
+
+namespace detail {
+
+    /**
+     * Calls body(begin, end) over [0, count) split into at most threads
+     * contiguous ranges of at least grain elements, the first one on the
+     * calling thread.
+     */
+    template<typename Body>
+    void parallelFor(size_t count, size_t threads, Body body, size_t grain = PARALLEL_GRAIN) {
+        size_t parts = std::min(threads, count / std::max<size_t>(grain, 1));
+        if (parts <= 1) {
+            body(size_t(0), count);
+            return;
+        }
+        size_t step = (count + parts - 1) / parts;
+        std::vector<std::thread> workers;
+        for (size_t begin = step; begin < count; begin += step) {
+            workers.emplace_back(body, begin, std::min(count, begin + step));
+        }
+        body(size_t(0), step);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // sorts equal chunks on separate threads, then merges them pairwise
+    template<typename Iterator, typename Compare>
+    void parallelSort(Iterator begin, Iterator end, Compare compare, size_t threads) {
+        const size_t count = end - begin;
+        const size_t parts = std::min(threads, count / PARALLEL_GRAIN);
+        if (parts <= 1) {
+            std::sort(begin, end, compare);
+            return;
+        }
+        std::vector<Iterator> bounds;
+        for (size_t part = 0; part <= parts; ++part) {
+            bounds.push_back(begin + count * part / parts);
+        }
+        parallelFor(parts, parts, [&](size_t first, size_t last) {
+            for (size_t part = first; part < last; ++part) {
+                std::sort(bounds[part], bounds[part + 1], compare);
+            }
+        }, 1);
+        for (size_t width = 1; width < parts; width *= 2) {
+            const size_t merges = (parts + 2 * width - 1) / (2 * width);
+            parallelFor(merges, parts, [&](size_t first, size_t last) {
+                for (size_t merge = first; merge < last; ++merge) {
+                    size_t left = 2 * width * merge;
+                    size_t middle = std::min(parts, left + width);
+                    size_t right = std::min(parts, left + 2 * width);
+                    std::inplace_merge(bounds[left], bounds[middle], bounds[right], compare);
+                }
+            }, 1);
+        }
+    }
+
+}  // namespace detail
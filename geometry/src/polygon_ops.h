@@ -0,0 +1,631 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+
+// intersections closer than this to a segment end, in fractions of the
+// segment, are treated as touching; clipping takes points closer than this
+// fraction of the inputs' extent as one point
+#define CLIP_TOLERANCE 1e-10
+// intersect() uses Sutherland-Hodgman when both polygons are convex and the
+// smaller one has at most this many vertices
+#define CONVEX_CLIP_VERTICES 64
+
+struct Segment {
+    Point a;
+    Point b;
+};
+
+struct SegmentIntersection {
+    size_t first;
+    size_t second;
+    Point point;
+};
+
+namespace detail {
+
+    inline double cross(const Point &o, const Point &a, const Point &b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    // twice the signed area, positive for counterclockwise vertices
+    inline double signedArea(const std::vector<Point> &vertices) {
+        double area = 0.0;
+        for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            area += (vertices[j].x - vertices[i].x) * (vertices[j].y + vertices[i].y);
+        }
+        return area;
+    }
+
+    enum Crossing {
+        NONE,
+        PROPER,
+        DEGENERATE
+    };
+
+    /**
+     * Intersection of p1p2 and q1q2 at p1 + t (p2 - p1) = q1 + u (q2 - q1).
+     * DEGENERATE means the segments touch at an end or overlap along a line;
+     * t then points at some common point.
+     */
+    inline Crossing crossSegments(const Point &p1, const Point &p2, const Point &q1, const Point &q2,
+                                  double &t, double &u) {
+        const double rx = p2.x - p1.x;
+        const double ry = p2.y - p1.y;
+        const double sx = q2.x - q1.x;
+        const double sy = q2.y - q1.y;
+        const double wx = q1.x - p1.x;
+        const double wy = q1.y - p1.y;
+        const double denominator = rx * sy - ry * sx;
+        const double r2 = rx * rx + ry * ry;
+        const double s2 = sx * sx + sy * sy;
+        if (fabs(denominator) <= CLIP_TOLERANCE * sqrt(r2 * s2)) {
+            // parallel: overlapping only if q1 is on the line through p1p2
+            if (fabs(wx * ry - wy * rx) > CLIP_TOLERANCE * sqrt(r2 * (wx * wx + wy * wy)) || r2 == 0.0) {
+                return NONE;
+            }
+            double t1 = (wx * rx + wy * ry) / r2;
+            double t2 = t1 + (sx * rx + sy * ry) / r2;
+            double low = std::max(0.0, std::min(t1, t2));
+            double high = std::min(1.0, std::max(t1, t2));
+            if (low > high) {
+                return NONE;
+            }
+            t = low;
+            u = 0.0;
+            return DEGENERATE;
+        }
+        t = (wx * sy - wy * sx) / denominator;
+        u = (wx * ry - wy * rx) / denominator;
+        if (t < -CLIP_TOLERANCE || t > 1 + CLIP_TOLERANCE || u < -CLIP_TOLERANCE || u > 1 + CLIP_TOLERANCE) {
+            return NONE;
+        }
+        if (t <= CLIP_TOLERANCE || t >= 1 - CLIP_TOLERANCE || u <= CLIP_TOLERANCE || u >= 1 - CLIP_TOLERANCE) {
+            t = std::min(1.0, std::max(0.0, t));
+            return DEGENERATE;
+        }
+        return PROPER;
+    }
+
+    struct SweepBox {
+        double minX;
+        double maxX;
+        double minY;
+        double maxY;
+        size_t index;
+        bool second;
+    };
+
+    /**
+     * Sweep and prune: boxes are swept left to right by minX and each is paired
+     * with the still open boxes it overlaps in y. report(i, j) gets the indices
+     * of both boxes; if bipartite only boxes from different sets are paired.
+     * Cost is n log n plus the number of x-overlapping pairs, which stays small
+     * for polygon edges.
+     */
+    template<typename Report>
+    void sweepPairs(std::vector<SweepBox> &boxes, bool bipartite, Report report) {
+        std::sort(boxes.begin(), boxes.end(), [](const SweepBox &lhs, const SweepBox &rhs) {
+            return lhs.minX < rhs.minX;
+        });
+        std::vector<const SweepBox *> open;
+        for (const SweepBox &box : boxes) {
+            size_t kept = 0;
+            for (const SweepBox *other : open) {
+                if (other->maxX < box.minX) {
+                    continue;
+                }
+                open[kept++] = other;
+                if ((!bipartite || other->second != box.second) && other->minY <= box.maxY && box.minY <= other->maxY) {
+                    report(*other, box);
+                }
+            }
+            open.resize(kept);
+            open.push_back(&box);
+        }
+    }
+
+    inline SweepBox edgeBox(const Point &a, const Point &b, size_t index, bool second) {
+        return SweepBox{std::min(a.x, b.x), std::max(a.x, b.x), std::min(a.y, b.y), std::max(a.y, b.y), index, second};
+    }
+
+    inline Point along(const Point &a, const Point &b, double t) {
+        return Point(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y));
+    }
+
+    /**
+     * Drops vertices lying within eps of the line through their neighbours:
+     * repeated points, collinear runs and zero-width spikes left where two
+     * boundaries met. Fewer than 3 vertices left mean there is no area.
+     */
+    inline void dropCollinear(std::vector<Point> &ring, double eps) {
+        auto flat = [eps](const Point &a, const Point &b, const Point &c) {
+            return fabs(cross(a, b, c)) <= eps * a.distance(c);
+        };
+        std::vector<Point> kept;
+        kept.reserve(ring.size());
+        for (const Point &p : ring) {
+            while (kept.size() >= 2 && flat(kept[kept.size() - 2], kept.back(), p)) {
+                kept.pop_back();
+            }
+            kept.push_back(p);
+        }
+        size_t first = 0;
+        while (kept.size() - first >= 3) {
+            if (flat(kept[kept.size() - 2], kept.back(), kept[first])) {
+                kept.pop_back();
+            } else if (flat(kept.back(), kept[first], kept[first + 1])) {
+                ++first;
+            } else {
+                break;
+            }
+        }
+        ring.assign(kept.begin() + first, kept.end());
+    }
+
+    /**
+     * Greiner-Hormann vertex lists extended to degenerate intersections, as
+     * in Foster, Hormann and Popa. Both rings are threaded into circular
+     * lists. Proper crossings are inserted into both lists, and a vertex that
+     * lies on the other boundary, on a vertex or inside an edge, is linked to
+     * its counterpart there. Every piece of either boundary between two nodes
+     * then runs inside, outside or along the other polygon. The result keeps
+     * the pieces on the requested side, plus the pieces both boundaries share
+     * in the same direction, and chains them into rings. Edges that touch or
+     * overlap therefore need no special handling.
+     */
+    class ClipGraph {
+    private:
+        static constexpr size_t NO_NODE = std::numeric_limits<size_t>::max();
+
+        enum Side {
+            INSIDE,
+            OUTSIDE,
+            SAME,       // along the other boundary, in the same direction
+            OPPOSITE    // along the other boundary, against it
+        };
+
+        struct Node {
+            Point p;
+            size_t next;
+            size_t prev;
+            // the same point in the other list
+            size_t neighbor;
+            // inserted where the edges cross properly
+            bool crossing;
+        };
+
+        struct Hit {
+            size_t edge;
+            double alpha;
+            size_t node;
+        };
+
+        // a piece of boundary kept for the result, between two identified nodes
+        struct Piece {
+            size_t from;
+            size_t to;
+            Point p;
+            size_t nextFrom;
+            bool used;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Side> sides;
+        size_t subjectSize = 0;
+        double eps = 0.0;
+
+        // links the ring starting at node first, with hits sorted along its edges
+        void link(size_t first, size_t count, std::vector<Hit> &hits) {
+            std::sort(hits.begin(), hits.end(), [](const Hit &lhs, const Hit &rhs) {
+                return lhs.edge < rhs.edge || (lhs.edge == rhs.edge && lhs.alpha < rhs.alpha);
+            });
+            std::vector<size_t> order;
+            order.reserve(count + hits.size());
+            size_t hit = 0;
+            for (size_t i = 0; i < count; ++i) {
+                order.push_back(first + i);
+                for (; hit < hits.size() && hits[hit].edge == i; ++hit) {
+                    order.push_back(hits[hit].node);
+                }
+            }
+            for (size_t i = 0; i < order.size(); ++i) {
+                nodes[order[i]].next = order[i + 1 == order.size() ? 0 : i + 1];
+                nodes[order[i]].prev = order[i == 0 ? order.size() - 1 : i - 1];
+            }
+        }
+
+        // node for a vertex lying on an edge of the other ring
+        size_t touch(size_t vertex) {
+            nodes.push_back(Node{nodes[vertex].p, 0, 0, vertex, false});
+            nodes[vertex].neighbor = nodes.size() - 1;
+            return nodes.size() - 1;
+        }
+
+        // strictly inside segment ab, at least eps away from both ends
+        bool onEdge(const Point &p, const Point &a, const Point &b, double &t) const {
+            const double length = a.distance(b);
+            if (length <= 2.0 * eps || fabs(cross(a, b, p)) > eps * length) {
+                return false;
+            }
+            t = ((p.x - a.x) * (b.x - a.x) + (p.y - a.y) * (b.y - a.y)) / (length * length);
+            return t * length > eps && (1.0 - t) * length > eps;
+        }
+
+        // the side of the other polygon the piece from -> to runs on
+        Side locate(const Node &from, const Node &to, const Polygon &other) const {
+            if (from.neighbor != NO_NODE && to.neighbor != NO_NODE) {
+                const Node &there = nodes[from.neighbor];
+                if (there.next == to.neighbor) {
+                    return SAME;
+                }
+                if (there.prev == to.neighbor) {
+                    return OPPOSITE;
+                }
+            }
+            return other.containsPoint(along(from.p, to.p, 0.5)) ? INSIDE : OUTSIDE;
+        }
+
+        // sides of the pieces of the ring starting at first: the side flips at
+        // every proper crossing and is looked up again after a degenerate node
+        void classify(size_t first, const Polygon &other) {
+            Side side = OUTSIDE;
+            size_t x = first;
+            do {
+                const Node &from = nodes[x];
+                if (x == first || (from.neighbor != NO_NODE && !from.crossing)) {
+                    side = locate(from, nodes[from.next], other);
+                } else if (from.crossing) {
+                    side = side == INSIDE ? OUTSIDE : INSIDE;
+                }
+                sides[x] = side;
+                x = from.next;
+            } while (x != first);
+        }
+
+        // linked nodes are one point of the result
+        size_t vertex(size_t x) const {
+            return std::min(x, nodes[x].neighbor);
+        }
+
+        // of several pieces leaving one point, the first clockwise from the way
+        // back, which keeps rings touching at that point apart
+        size_t follow(const std::vector<Piece> &pieces, const std::vector<size_t> &head, size_t piece) const {
+            const Point &back = pieces[piece].p;
+            size_t best = NO_NODE;
+            double bestTurn = 0.0;
+            for (size_t next = head[pieces[piece].to]; next != NO_NODE; next = pieces[next].nextFrom) {
+                if (pieces[next].used) {
+                    continue;
+                }
+                const Point &at = pieces[next].p;
+                const Point &ahead = nodes[pieces[next].to].p;
+                const double rx = back.x - at.x;
+                const double ry = back.y - at.y;
+                const double cx = ahead.x - at.x;
+                const double cy = ahead.y - at.y;
+                double turn = atan2(cx * ry - cy * rx, rx * cx + ry * cy);
+                if (turn <= 0.0) {
+                    turn += 2.0 * PI;
+                }
+                if (best == NO_NODE || turn < bestTurn) {
+                    best = next;
+                    bestTurn = turn;
+                }
+            }
+            return best;
+        }
+
+    public:
+        void build(const std::vector<Point> &subject, const std::vector<Point> &clip, double tolerance) {
+            subjectSize = subject.size();
+            const size_t clipSize = clip.size();
+            eps = tolerance;
+            nodes.clear();
+            for (const std::vector<Point> *ring : {&subject, &clip}) {
+                for (const Point &p : *ring) {
+                    nodes.push_back(Node{p, 0, 0, NO_NODE, false});
+                }
+            }
+
+            // boxes grow by eps so that vertices just off an edge still meet it
+            std::vector<SweepBox> boxes;
+            boxes.reserve(subjectSize + clipSize);
+            for (size_t i = 0; i < subjectSize; ++i) {
+                boxes.push_back(edgeBox(subject[i], subject[(i + 1) % subjectSize], i, false));
+            }
+            for (size_t i = 0; i < clipSize; ++i) {
+                boxes.push_back(edgeBox(clip[i], clip[(i + 1) % clipSize], i, true));
+            }
+            for (SweepBox &box : boxes) {
+                box.minX -= eps;
+                box.maxX += eps;
+                box.minY -= eps;
+                box.maxY += eps;
+            }
+
+            // every pair checks the start vertex of each edge against the
+            // other edge; the end vertices are the start of the next edges
+            std::vector<Hit> subjectHits;
+            std::vector<Hit> clipHits;
+            sweepPairs(boxes, true, [&](const SweepBox &lhs, const SweepBox &rhs) {
+                const size_t i = lhs.second ? rhs.index : lhs.index;
+                const size_t j = lhs.second ? lhs.index : rhs.index;
+                const Point &a = subject[i];
+                const Point &b = subject[(i + 1) % subjectSize];
+                const Point &c = clip[j];
+                const Point &d = clip[(j + 1) % clipSize];
+                const size_t p = i;
+                const size_t q = subjectSize + j;
+                if (fabs(a.x - c.x) <= eps && fabs(a.y - c.y) <= eps) {
+                    if (nodes[p].neighbor == NO_NODE && nodes[q].neighbor == NO_NODE) {
+                        nodes[p].neighbor = q;
+                        nodes[q].neighbor = p;
+                    }
+                    return;
+                }
+                double t;
+                bool touching = false;
+                if (nodes[p].neighbor == NO_NODE && onEdge(a, c, d, t)) {
+                    clipHits.push_back(Hit{j, t, touch(p)});
+                    touching = true;
+                }
+                if (nodes[q].neighbor == NO_NODE && onEdge(c, a, b, t)) {
+                    subjectHits.push_back(Hit{i, t, touch(q)});
+                    touching = true;
+                }
+                if (touching) {
+                    return;
+                }
+                // signed distances of each segment's ends from the other one
+                const double cdLength = c.distance(d);
+                const double abLength = a.distance(b);
+                const double da = cross(c, d, a) / cdLength;
+                const double db = cross(c, d, b) / cdLength;
+                const double dc = cross(a, b, c) / abLength;
+                const double dd = cross(a, b, d) / abLength;
+                const bool crossesCd = (da > eps && db < -eps) || (da < -eps && db > eps);
+                const bool crossesAb = (dc > eps && dd < -eps) || (dc < -eps && dd > eps);
+                if (crossesCd && crossesAb) {
+                    const double alpha = da / (da - db);
+                    const Point x = along(a, b, alpha);
+                    subjectHits.push_back(Hit{i, alpha, nodes.size()});
+                    clipHits.push_back(Hit{j, dc / (dc - dd), nodes.size() + 1});
+                    nodes.push_back(Node{x, 0, 0, nodes.size() + 1, true});
+                    nodes.push_back(Node{x, 0, 0, nodes.size() - 1, true});
+                }
+            });
+            link(0, subjectSize, subjectHits);
+            link(subjectSize, clipSize, clipHits);
+        }
+
+        // rings of the intersection, or of the union if unite
+        std::vector<Polygon> trace(const Polygon &subject, const Polygon &clip, bool unite) {
+            sides.assign(nodes.size(), OUTSIDE);
+            classify(0, clip);
+            classify(subjectSize, subject);
+
+            const Side keep = unite ? OUTSIDE : INSIDE;
+            std::vector<Piece> pieces;
+            std::vector<size_t> head(nodes.size(), NO_NODE);
+            for (size_t first : {size_t(0), subjectSize}) {
+                size_t x = first;
+                do {
+                    // a stretch shared in the same direction is taken once
+                    if (sides[x] == keep || (first == 0 && sides[x] == SAME)) {
+                        const size_t from = vertex(x);
+                        pieces.push_back(Piece{from, vertex(nodes[x].next), nodes[x].p, head[from], false});
+                        head[from] = pieces.size() - 1;
+                    }
+                    x = nodes[x].next;
+                } while (x != first);
+            }
+
+            std::vector<Polygon> result;
+            std::vector<Point> ring;
+            for (size_t start = 0; start < pieces.size(); ++start) {
+                if (pieces[start].used) {
+                    continue;
+                }
+                ring.clear();
+                bool closed = false;
+                for (size_t piece = start; piece != NO_NODE; piece = follow(pieces, head, piece)) {
+                    pieces[piece].used = true;
+                    ring.push_back(pieces[piece].p);
+                    if (pieces[piece].to == pieces[start].from) {
+                        closed = true;
+                        break;
+                    }
+                }
+                dropCollinear(ring, eps);
+                if (closed && ring.size() >= 3) {
+                    result.emplace_back(ring);
+                }
+            }
+            return result;
+        }
+    };
+
+    inline std::vector<Point> counterclockwise(const Polygon &polygon) {
+        std::vector<Point> vertices = polygon.getVertices();
+        if (signedArea(vertices) < 0.0) {
+            std::reverse(vertices.begin(), vertices.end());
+        }
+        return vertices;
+    }
+
+    // points closer than this are one point for clipping the two polygons
+    inline double clipTolerance(const Polygon &lhs, const Polygon &rhs) {
+        BoundingBox box = lhs.boundingBox().merged(rhs.boundingBox());
+        return std::max(box.maxX - box.minX, box.maxY - box.minY) * CLIP_TOLERANCE;
+    }
+
+    inline std::vector<Polygon> clip(const Polygon &subject, const Polygon &clip, bool unite) {
+        ClipGraph graph;
+        graph.build(counterclockwise(subject), counterclockwise(clip), clipTolerance(subject, clip));
+        return graph.trace(subject, clip, unite);
+    }
+
+}  // namespace detail
+
+/**
+ * Convex hull by Andrew's monotone chain in O(n log n): vertices go
+ * counterclockwise from the lowest-leftmost point and collinear points are
+ * dropped. Points that all lie on one line have no hull polygon, and the
+ * Polygon constructor throws std::invalid_argument for them.
+ */
+inline Polygon convexHull(std::vector<Point> points) {
+    std::sort(points.begin(), points.end(), [](const Point &lhs, const Point &rhs) {
+        return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+    });
+    // exact: the tolerant Point == is relative to the coordinates and would
+    // merge distinct corners of a small polygon far from the origin
+    points.erase(std::unique(points.begin(), points.end(), [](const Point &lhs, const Point &rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }), points.end());
+    std::vector<Point> hull;
+    hull.reserve(points.size() + 1);
+    // lower chain left to right, then upper chain right to left
+    for (int pass = 0; pass < 2; ++pass) {
+        const size_t base = hull.size();
+        for (const Point &p : points) {
+            while (hull.size() >= base + 2 && detail::cross(hull[hull.size() - 2], hull.back(), p) <= 0.0) {
+                hull.pop_back();
+            }
+            hull.push_back(p);
+        }
+        hull.pop_back();
+        std::reverse(points.begin(), points.end());
+    }
+    return Polygon(std::move(hull));
+}
+
+inline Polygon convexHull(const Polygon &polygon) {
+    return convexHull(polygon.getVertices());
+}
+
+/**
+ * All turns go the same way, collinear vertices allowed, and the boundary
+ * winds around once, which rules out self-intersecting stars.
+ */
+inline bool isConvex(const Polygon &polygon) {
+    const std::vector<Point> &v = polygon.getVertices();
+    const size_t n = v.size();
+    if (n < 3) {
+        return false;
+    }
+    int turn = 0;
+    int xFlips = 0;
+    int xSign = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Point &a = v[i];
+        const Point &b = v[(i + 1) % n];
+        const Point &c = v[(i + 2) % n];
+        double z = detail::cross(a, b, c);
+        if (z != 0.0) {
+            int sign = z > 0.0 ? 1 : -1;
+            if (turn != 0 && sign != turn) {
+                return false;
+            }
+            turn = sign;
+        }
+        if (b.x != a.x) {
+            int sign = b.x > a.x ? 1 : -1;
+            xFlips += xSign != 0 && sign != xSign;
+            xSign = sign;
+        }
+    }
+    return turn != 0 && xFlips <= 2;
+}
+
+/**
+ * Sutherland-Hodgman: the subject is clipped by the half-plane of every edge
+ * of a convex clip polygon in turn, O(nm). The result is empty or a single
+ * counterclockwise polygon; polygons meeting only along an edge or at a
+ * point give an empty result.
+ */
+inline std::vector<Polygon> clipConvex(const Polygon &subject, const Polygon &clip) {
+    std::vector<Point> clipVertices = detail::counterclockwise(clip);
+    std::vector<Point> current = detail::counterclockwise(subject);
+    std::vector<Point> next;
+    for (size_t e = 0; e < clipVertices.size() && !current.empty(); ++e) {
+        const Point &a = clipVertices[e];
+        const Point &b = clipVertices[(e + 1) % clipVertices.size()];
+        next.clear();
+        for (size_t i = 0; i < current.size(); ++i) {
+            const Point &from = current[i == 0 ? current.size() - 1 : i - 1];
+            const Point &to = current[i];
+            double sideFrom = detail::cross(a, b, from);
+            double sideTo = detail::cross(a, b, to);
+            if ((sideFrom >= 0.0) != (sideTo >= 0.0)) {
+                next.push_back(detail::along(from, to, sideFrom / (sideFrom - sideTo)));
+            }
+            if (sideTo >= 0.0) {
+                next.push_back(to);
+            }
+        }
+        std::swap(current, next);
+    }
+    detail::dropCollinear(current, detail::clipTolerance(subject, clip));
+    if (current.size() < 3) {
+        return {};
+    }
+    return {Polygon(std::move(current))};
+}
+
+/**
+ * Intersection of two polygons as a set of rings. Two convex polygons, one of
+ * them small, go through Sutherland-Hodgman; everything else through the
+ * extended Greiner-Hormann lists above, whose edge crossings are found by
+ * sweep and prune in about n log n for map-like polygons. Shared edges and
+ * touching vertices are exact cases there: parts that meet only along a line
+ * or at a point give no ring.
+ */
+inline std::vector<Polygon> intersect(const Polygon &lhs, const Polygon &rhs) {
+    const Polygon &small = lhs.verticesCount() <= rhs.verticesCount() ? lhs : rhs;
+    const Polygon &large = &small == &lhs ? rhs : lhs;
+    if (small.verticesCount() <= CONVEX_CLIP_VERTICES && isConvex(small) && isConvex(large)) {
+        return clipConvex(large, small);
+    }
+    return detail::clip(lhs, rhs, false);
+}
+
+/**
+ * Union of two polygons as a set of rings, counterclockwise for outer
+ * boundaries and clockwise for holes. Polygons sharing an edge merge into one
+ * ring; polygons touching at a vertex stay separate rings.
+ */
+inline std::vector<Polygon> unite(const Polygon &lhs, const Polygon &rhs) {
+    return detail::clip(lhs, rhs, true);
+}
+
+/**
+ * Every pair of intersecting segments, touching and overlapping ones
+ * included, with one common point each. Candidates come from a sweep over
+ * bounding boxes, so the cost is n log n plus the pairs overlapping in x.
+ */
+inline std::vector<SegmentIntersection> segmentIntersections(const std::vector<Segment> &segments) {
+    std::vector<detail::SweepBox> boxes;
+    boxes.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        boxes.push_back(detail::edgeBox(segments[i].a, segments[i].b, i, false));
+    }
+    std::vector<SegmentIntersection> result;
+    detail::sweepPairs(boxes, false, [&](const detail::SweepBox &lhs, const detail::SweepBox &rhs) {
+        const Segment &first = segments[lhs.index];
+        const Segment &second = segments[rhs.index];
+        double t;
+        double u;
+        if (detail::crossSegments(first.a, first.b, second.a, second.b, t, u) != detail::NONE) {
+            result.push_back(SegmentIntersection{std::min(lhs.index, rhs.index), std::max(lhs.index, rhs.index),
+                                                 detail::along(first.a, first.b, t)});
+        }
+    });
+    return result;
+}
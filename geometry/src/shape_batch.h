@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+
+/**
+ * Many shapes stored by kind in structure-of-arrays layout: all polygon
+ * vertices in two coordinate arrays with per-polygon offsets, ellipses and
+ * circles as parallel arrays of their parameters. Transforms and measures run
+ * over whole arrays in plain loops the compiler can vectorize, with no
+ * virtual calls and no per-shape allocations.
+ *
+ * Shapes are numbered in the order they were added; areas() and perimeters()
+ * write one value per shape in that order.
+ */
+class ShapeBatch {
+private:
+    enum Kind {
+        POLYGON,
+        ELLIPSE,
+        CIRCLE
+    };
+
+    // kind and index within that kind for every shape, in insertion order
+    std::vector<Kind> kinds;
+    std::vector<size_t> indices;
+
+    std::vector<double> vx;
+    std::vector<double> vy;
+    std::vector<size_t> offsets = {0};
+
+    std::vector<double> f1x;
+    std::vector<double> f1y;
+    std::vector<double> f2x;
+    std::vector<double> f2y;
+    std::vector<double> semiMajor;
+    std::vector<double> semiMinor;
+
+    std::vector<double> cx;
+    std::vector<double> cy;
+    std::vector<double> radii;
+
+    std::vector<size_t> polygonIds;
+    std::vector<size_t> ellipseIds;
+    std::vector<size_t> circleIds;
+
+    size_t threads = 1;
+
+    void add(Kind kind, size_t index, std::vector<size_t> &ids) {
+        ids.push_back(kinds.size());
+        kinds.push_back(kind);
+        indices.push_back(index);
+    }
+
+    // p' = (m00 x + m01 y + tx, m10 x + m11 y + ty) over n points
+    static void transformPoints(double *x, double *y, size_t n, const Transform::Matrix &m) {
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; ++i) {
+            double px = x[i];
+            double py = y[i];
+            x[i] = m[0] * px + m[1] * py + m[4];
+            y[i] = m[2] * px + m[3] * py + m[5];
+        }
+    }
+
+    static void scaleLengths(double *lengths, size_t n, double factor) {
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; ++i) {
+            lengths[i] *= factor;
+        }
+    }
+
+    double polygonArea(size_t polygon) const {
+        const size_t begin = offsets[polygon];
+        const size_t end = offsets[polygon + 1];
+        const double *x = vx.data();
+        const double *y = vy.data();
+        // two independent sums, so consecutive additions do not wait for each other
+        double even = 0.0;
+        double odd = 0.0;
+        size_t i = begin + 1;
+        for (; i + 1 < end; i += 2) {
+            even += (x[i] + x[i - 1]) * (y[i] - y[i - 1]);
+            odd += (x[i + 1] + x[i]) * (y[i + 1] - y[i]);
+        }
+        for (; i < end; ++i) {
+            even += (x[i] + x[i - 1]) * (y[i] - y[i - 1]);
+        }
+        even += (x[begin] + x[end - 1]) * (y[begin] - y[end - 1]);
+        return fabs(even + odd) / 2.0;
+    }
+
+    double polygonPerimeter(size_t polygon) const {
+        const size_t begin = offsets[polygon];
+        const size_t end = offsets[polygon + 1];
+        const double *x = vx.data();
+        const double *y = vy.data();
+        double even = 0.0;
+        double odd = 0.0;
+        size_t i = begin + 1;
+        for (; i + 1 < end; i += 2) {
+            even += sqrt(square(x[i] - x[i - 1]) + square(y[i] - y[i - 1]));
+            odd += sqrt(square(x[i + 1] - x[i]) + square(y[i + 1] - y[i]));
+        }
+        for (; i < end; ++i) {
+            even += sqrt(square(x[i] - x[i - 1]) + square(y[i] - y[i - 1]));
+        }
+        even += sqrt(square(x[begin] - x[end - 1]) + square(y[begin] - y[end - 1]));
+        return even + odd;
+    }
+
+public:
+    // shapes above PARALLEL_GRAIN per thread are processed by that many threads
+    void setThreads(size_t count) {
+        threads = std::max<size_t>(count, 1);
+    }
+
+    size_t size() const {
+        return kinds.size();
+    }
+
+    void reserve(size_t polygons, size_t vertices, size_t ellipses, size_t circles) {
+        kinds.reserve(polygons + ellipses + circles);
+        indices.reserve(polygons + ellipses + circles);
+        vx.reserve(vertices);
+        vy.reserve(vertices);
+        offsets.reserve(polygons + 1);
+        polygonIds.reserve(polygons);
+        for (auto array : {&f1x, &f1y, &f2x, &f2y, &semiMajor, &semiMinor}) {
+            array->reserve(ellipses);
+        }
+        ellipseIds.reserve(ellipses);
+        cx.reserve(circles);
+        cy.reserve(circles);
+        radii.reserve(circles);
+        circleIds.reserve(circles);
+    }
+
+    // returns the number of the added shape
+    size_t add(const Polygon &polygon) {
+        for (const Point &vertex : polygon.getVertices()) {
+            vx.push_back(vertex.x);
+            vy.push_back(vertex.y);
+        }
+        offsets.push_back(vx.size());
+        add(POLYGON, offsets.size() - 2, polygonIds);
+        return kinds.size() - 1;
+    }
+
+    size_t add(const Ellipse &ellipse) {
+        auto focuses = ellipse.focuses();
+        f1x.push_back(focuses.first.x);
+        f1y.push_back(focuses.first.y);
+        f2x.push_back(focuses.second.x);
+        f2y.push_back(focuses.second.y);
+        semiMajor.push_back(ellipse.semiMajorAxis());
+        semiMinor.push_back(ellipse.semiMinorAxis());
+        add(ELLIPSE, semiMajor.size() - 1, ellipseIds);
+        return kinds.size() - 1;
+    }
+
+    size_t add(const Circle &circle) {
+        Point center = circle.center();
+        cx.push_back(center.x);
+        cy.push_back(center.y);
+        radii.push_back(circle.radius());
+        add(CIRCLE, radii.size() - 1, circleIds);
+        return kinds.size() - 1;
+    }
+
+    // picks the most derived kind of a shape from the hierarchy
+    size_t add(const Shape &shape) {
+        if (auto circle = dynamic_cast<const Circle *>(&shape)) {
+            return add(*circle);
+        }
+        if (auto ellipse = dynamic_cast<const Ellipse *>(&shape)) {
+            return add(*ellipse);
+        }
+        return add(dynamic_cast<const Polygon &>(shape));
+    }
+
+    bool isPolygon(size_t id) const {
+        return kinds[id] == POLYGON;
+    }
+
+    bool isEllipse(size_t id) const {
+        return kinds[id] == ELLIPSE;
+    }
+
+    bool isCircle(size_t id) const {
+        return kinds[id] == CIRCLE;
+    }
+
+    Polygon polygon(size_t id) const {
+        size_t polygon = indices[id];
+        std::vector<Point> vertices;
+        vertices.reserve(offsets[polygon + 1] - offsets[polygon]);
+        for (size_t i = offsets[polygon]; i < offsets[polygon + 1]; ++i) {
+            vertices.emplace_back(vx[i], vy[i]);
+        }
+        return Polygon(std::move(vertices));
+    }
+
+    Ellipse ellipse(size_t id) const {
+        size_t i = indices[id];
+        return Ellipse(Point(f1x[i], f1y[i]), Point(f2x[i], f2y[i]), 2.0 * semiMajor[i]);
+    }
+
+    Circle circle(size_t id) const {
+        size_t i = indices[id];
+        return Circle(Point(cx[i], cy[i]), radii[i]);
+    }
+
+    void rotate(const Point &pivot, const double &angle) {
+        apply(Transform::rotation(pivot, angle));
+    }
+
+    void reflex(const Point &pivot) {
+        apply(Transform::reflection(pivot));
+    }
+
+    void reflex(const Line &line) {
+        apply(Transform::reflection(line));
+    }
+
+    void scale(const Point &pivot, const double &coefficient) {
+        apply(Transform::scaling(pivot, coefficient));
+    }
+
+    void apply(const Transform &transform) {
+        const Transform::Matrix &m = transform.coefficients();
+        auto points = [&](std::vector<double> &x, std::vector<double> &y) {
+            detail::parallelFor(x.size(), threads, [&](size_t begin, size_t end) {
+                transformPoints(x.data() + begin, y.data() + begin, end - begin, m);
+            });
+        };
+        points(vx, vy);
+        points(f1x, f1y);
+        points(f2x, f2y);
+        points(cx, cy);
+        const double factor = transform.lengthFactor();
+        if (factor != 1.0) {
+            scaleLengths(semiMajor.data(), semiMajor.size(), factor);
+            scaleLengths(semiMinor.data(), semiMinor.size(), factor);
+            scaleLengths(radii.data(), radii.size(), factor);
+        }
+    }
+
+    // out[id] is the area of shape id; out is resized to size()
+    void areas(std::vector<double> &out) const {
+        out.resize(size());
+        double *res = out.data();
+        detail::parallelFor(polygonIds.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                res[polygonIds[i]] = polygonArea(i);
+            }
+        });
+        for (size_t i = 0; i < ellipseIds.size(); ++i) {
+            res[ellipseIds[i]] = PI * semiMajor[i] * semiMinor[i];
+        }
+        for (size_t i = 0; i < circleIds.size(); ++i) {
+            res[circleIds[i]] = PI * square(radii[i]);
+        }
+    }
+
+    // out[id] is the perimeter of shape id; out is resized to size()
+    void perimeters(std::vector<double> &out) const {
+        out.resize(size());
+        double *res = out.data();
+        detail::parallelFor(polygonIds.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                res[polygonIds[i]] = polygonPerimeter(i);
+            }
+        });
+        detail::parallelFor(ellipseIds.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                double a = semiMajor[i];
+                res[ellipseIds[i]] = 4 * a * std::comp_ellint_2(sqrt(square(a) - square(semiMinor[i])) / a);
+            }
+        });
+        for (size_t i = 0; i < circleIds.size(); ++i) {
+            res[circleIds[i]] = 2 * PI * radii[i];
+        }
+    }
+};
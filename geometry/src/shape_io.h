@@ -0,0 +1,548 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "geometry.h"
+
+#define SHAPE_FILE_MAGIC 0x534f4547u  // "GEOS" in little-endian order
+#define SHAPE_FILE_VERSION 1u
+// the text reader and writer move data in chunks of this many bytes
+#define TEXT_BUFFER_SIZE (1u << 16)
+// longest number the text reader accepts
+#define TEXT_TOKEN_LENGTH 128
+
+static_assert(std::is_trivially_copyable<Point>::value && sizeof(Point) == 2 * sizeof(double),
+              "Points are stored in files as two doubles!");
+
+enum class ShapeKind : uint32_t {
+    POLYGON = 1,
+    ELLIPSE = 2,
+    CIRCLE = 3
+};
+
+/**
+ * Binary shape files, in native byte order:
+ *
+ *     file   := uint32 magic, uint32 version, record*
+ *     record := uint32 kind, uint32 zero, uint64 count, double[2 * count]
+ *
+ * A polygon stores its vertices as count >= 3 points; an ellipse stores its
+ * foci and the sum of distances to them, a circle its center and radius,
+ * with the number as the last point's x and a zero y. Every field starts at a
+ * multiple of 8 bytes, so a mapped file can be read in place.
+ */
+namespace detail {
+
+    struct RecordHeader {
+        uint32_t kind;
+        uint32_t zero;
+        uint64_t count;
+    };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+}  // namespace detail
+
+class ShapeWriter {
+private:
+    std::ostream &stream;
+
+    void record(ShapeKind kind, const Point *points, size_t count) {
+        detail::RecordHeader header{static_cast<uint32_t>(kind), 0, count};
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(points), count * sizeof(Point));
+    }
+
+public:
+    explicit ShapeWriter(std::ostream &stream) : stream(stream) {
+        detail::FileHeader header{SHAPE_FILE_MAGIC, SHAPE_FILE_VERSION};
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void write(const Polygon &polygon) {
+        const std::vector<Point> &vertices = polygon.getVertices();
+        record(ShapeKind::POLYGON, vertices.data(), vertices.size());
+    }
+
+    void write(const Ellipse &ellipse) {
+        auto focuses = ellipse.focuses();
+        const Point points[3] = {focuses.first, focuses.second, Point(2.0 * ellipse.semiMajorAxis(), 0.0)};
+        record(ShapeKind::ELLIPSE, points, 3);
+    }
+
+    void write(const Circle &circle) {
+        const Point points[2] = {circle.center(), Point(circle.radius(), 0.0)};
+        record(ShapeKind::CIRCLE, points, 2);
+    }
+
+    void write(const Shape &shape) {
+        if (auto circle = dynamic_cast<const Circle *>(&shape)) {
+            write(*circle);
+        } else if (auto ellipse = dynamic_cast<const Ellipse *>(&shape)) {
+            write(*ellipse);
+        } else {
+            write(dynamic_cast<const Polygon &>(shape));
+        }
+    }
+};
+
+/**
+ * Vertices of a polygon stored elsewhere, typically in a mapped file. Valid
+ * as long as the storage is.
+ */
+class PolygonView {
+private:
+    const Point *points;
+    size_t count;
+
+public:
+    PolygonView(const Point *points, size_t count) : points(points), count(count) {}
+
+    size_t verticesCount() const {
+        return count;
+    }
+
+    const Point *begin() const {
+        return points;
+    }
+
+    const Point *end() const {
+        return points + count;
+    }
+
+    const Point &operator[](size_t i) const {
+        return points[i];
+    }
+
+    double area() const {
+        double area = 0.0;
+        for (size_t i = 0, j = count - 1; i < count; j = i++) {
+            area += (points[i].x + points[j].x) * (points[i].y - points[j].y);
+        }
+        return fabs(area) / 2.0;
+    }
+
+    double perimeter() const {
+        double sum = 0.0;
+        for (size_t i = 0, j = count - 1; i < count; j = i++) {
+            sum += points[i].distance(points[j]);
+        }
+        return sum;
+    }
+
+    BoundingBox boundingBox() const {
+        BoundingBox box = BoundingBox::empty();
+        for (const Point &p : *this) {
+            box.extend(p);
+        }
+        return box;
+    }
+
+    // copies the vertices into a standalone polygon
+    Polygon polygon() const {
+        return Polygon(std::vector<Point>(points, points + count));
+    }
+};
+
+/**
+ * A binary shape file mapped into memory. Opening reads only the record
+ * headers; polygon() returns views straight into the mapping, so vertices
+ * are paged in from disk as they are touched and never copied. Throws
+ * std::runtime_error if the file cannot be mapped or is malformed.
+ */
+class MappedShapes {
+private:
+    struct Entry {
+        ShapeKind kind;
+        const Point *points;
+        size_t count;
+    };
+
+    void *data = nullptr;
+    size_t length = 0;
+    std::vector<Entry> entries;
+
+    void release() {
+        if (data != nullptr) {
+            munmap(data, length);
+            data = nullptr;
+        }
+    }
+
+    void index() {
+        const char *bytes = static_cast<const char *>(data);
+        detail::FileHeader file;
+        if (length < sizeof(file)) {
+            throw std::runtime_error("Shape file is too short!");
+        }
+        std::memcpy(&file, bytes, sizeof(file));
+        if (file.magic != SHAPE_FILE_MAGIC || file.version != SHAPE_FILE_VERSION) {
+            throw std::runtime_error("Not a shape file or unsupported version!");
+        }
+        size_t offset = sizeof(file);
+        while (offset < length) {
+            detail::RecordHeader header;
+            if (length - offset < sizeof(header)) {
+                throw std::runtime_error("Shape file is truncated!");
+            }
+            std::memcpy(&header, bytes + offset, sizeof(header));
+            offset += sizeof(header);
+            const ShapeKind kind = static_cast<ShapeKind>(header.kind);
+            const bool valid = (kind == ShapeKind::POLYGON && header.count >= 3) ||
+                               (kind == ShapeKind::ELLIPSE && header.count == 3) ||
+                               (kind == ShapeKind::CIRCLE && header.count == 2);
+            if (!valid || header.count > (length - offset) / sizeof(Point)) {
+                throw std::runtime_error("Shape file is malformed!");
+            }
+            entries.push_back(Entry{kind, reinterpret_cast<const Point *>(bytes + offset), header.count});
+            offset += header.count * sizeof(Point);
+        }
+    }
+
+public:
+    explicit MappedShapes(const std::string &path) {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size == 0) {
+            close(file);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            throw std::runtime_error("Cannot map " + path);
+        }
+        try {
+            index();
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    MappedShapes(const MappedShapes &) = delete;
+
+    MappedShapes &operator=(const MappedShapes &) = delete;
+
+    ~MappedShapes() {
+        release();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    ShapeKind kind(size_t id) const {
+        return entries[id].kind;
+    }
+
+    PolygonView polygon(size_t id) const {
+        return PolygonView(entries[id].points, entries[id].count);
+    }
+
+    Ellipse ellipse(size_t id) const {
+        const Point *p = entries[id].points;
+        return Ellipse(p[0], p[1], p[2].x);
+    }
+
+    Circle circle(size_t id) const {
+        const Point *p = entries[id].points;
+        return Circle(p[0], p[1].x);
+    }
+};
+
+/**
+ * Text shapes, one per line, in a WKT-like notation:
+ *
+ *     POLYGON ((x y, x y, ..., x y))
+ *     ELLIPSE (x y, x y, distance sum)
+ *     CIRCLE (x y, radius)
+ *
+ * As in WKT the writer repeats the first vertex at the end of a polygon and
+ * the reader drops it again. Numbers are written with std::to_chars in the
+ * shortest form that reads back exactly.
+ */
+class ShapeTextWriter {
+private:
+    std::ostream &stream;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    void reserve(size_t bytes) {
+        if (buffer.size() - used < bytes) {
+            flush();
+        }
+    }
+
+    void text(const char *s) {
+        size_t n = strlen(s);
+        reserve(n);
+        std::memcpy(buffer.data() + used, s, n);
+        used += n;
+    }
+
+    void number(double value) {
+        reserve(TEXT_TOKEN_LENGTH);
+        auto res = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+        used = res.ptr - buffer.data();
+    }
+
+    void point(const Point &p) {
+        number(p.x);
+        text(" ");
+        number(p.y);
+    }
+
+public:
+    explicit ShapeTextWriter(std::ostream &stream) : stream(stream), buffer(TEXT_BUFFER_SIZE) {}
+
+    ShapeTextWriter(const ShapeTextWriter &) = delete;
+
+    ShapeTextWriter &operator=(const ShapeTextWriter &) = delete;
+
+    ~ShapeTextWriter() {
+        flush();
+    }
+
+    void flush() {
+        stream.write(buffer.data(), used);
+        used = 0;
+    }
+
+    // a Polygon always has a first vertex to close the ring with
+    void write(const Polygon &polygon) {
+        const std::vector<Point> &vertices = polygon.getVertices();
+        text("POLYGON ((");
+        for (const Point &vertex : vertices) {
+            point(vertex);
+            text(", ");
+        }
+        point(vertices.front());
+        text("))\n");
+    }
+
+    void write(const Ellipse &ellipse) {
+        auto focuses = ellipse.focuses();
+        text("ELLIPSE (");
+        point(focuses.first);
+        text(", ");
+        point(focuses.second);
+        text(", ");
+        number(2.0 * ellipse.semiMajorAxis());
+        text(")\n");
+    }
+
+    void write(const Circle &circle) {
+        text("CIRCLE (");
+        point(circle.center());
+        text(", ");
+        number(circle.radius());
+        text(")\n");
+    }
+
+    void write(const Shape &shape) {
+        if (auto circle = dynamic_cast<const Circle *>(&shape)) {
+            write(*circle);
+        } else if (auto ellipse = dynamic_cast<const Ellipse *>(&shape)) {
+            write(*ellipse);
+        } else {
+            write(dynamic_cast<const Polygon &>(shape));
+        }
+    }
+};
+
+/**
+ * Streaming reader for the text notation above. Input is pulled from the
+ * stream buffer in large chunks and numbers are parsed in place with
+ * std::from_chars, so the cost per number is a scan over its characters.
+ *
+ *     ShapeTextReader reader(in);
+ *     while (reader.next()) {
+ *         if (reader.kind() == ShapeKind::POLYGON) {
+ *             ... reader.points() ...
+ *         }
+ *     }
+ *     if (reader.failed()) {
+ *         ...
+ *     }
+ */
+class ShapeTextReader {
+private:
+    std::streambuf *source;
+    std::vector<char> buffer;
+    size_t begin = 0;
+    size_t end = 0;
+    bool exhausted = false;
+    bool invalid = false;
+
+    ShapeKind kind_ = ShapeKind::POLYGON;
+    std::vector<Point> points_;
+    double parameter_ = 0.0;
+
+    // makes at least want bytes available unless the input ends first
+    bool fill(size_t want) {
+        if (end - begin >= want || exhausted) {
+            return end - begin >= want;
+        }
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        while (end < want && !exhausted) {
+            std::streamsize got = source->sgetn(buffer.data() + end, buffer.size() - end);
+            exhausted = got <= 0;
+            end += std::max<std::streamsize>(got, 0);
+        }
+        return end - begin >= want;
+    }
+
+    // next non-blank character, left unconsumed; 0 at the end of input
+    char peek() {
+        while (true) {
+            while (begin < end) {
+                char c = buffer[begin];
+                if (c != ' ' && c != '\n' && c != '\t' && c != '\r') {
+                    return c;
+                }
+                ++begin;
+            }
+            if (!fill(1)) {
+                return 0;
+            }
+        }
+    }
+
+    bool expect(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        ++begin;
+        return true;
+    }
+
+    bool word(const char *w) {
+        const size_t n = strlen(w);
+        if (!fill(n) || std::memcmp(buffer.data() + begin, w, n) != 0) {
+            return false;
+        }
+        begin += n;
+        return true;
+    }
+
+    bool number(double &value) {
+        peek();
+        fill(TEXT_TOKEN_LENGTH);
+        const char *first = buffer.data() + begin;
+        const char *last = buffer.data() + end;
+        auto res = std::from_chars(first, last, value);
+        if (res.ec != std::errc() || (res.ptr == last && !exhausted)) {
+            return false;
+        }
+        begin += res.ptr - first;
+        return true;
+    }
+
+    bool point() {
+        double x;
+        double y;
+        if (!number(x) || !number(y)) {
+            return false;
+        }
+        points_.emplace_back(x, y);
+        return true;
+    }
+
+    bool parse() {
+        points_.clear();
+        if (peek() == 'P') {
+            kind_ = ShapeKind::POLYGON;
+            if (!word("POLYGON") || !expect('(') || !expect('(') || !point()) {
+                return false;
+            }
+            while (expect(',')) {
+                if (!point()) {
+                    return false;
+                }
+            }
+            const Point &first = points_.front();
+            if (points_.size() > 1 && points_.back().x == first.x && points_.back().y == first.y) {
+                points_.pop_back();
+            }
+            // fewer vertices would not make a Polygon
+            return points_.size() >= 3 && expect(')') && expect(')');
+        }
+        if (peek() == 'E') {
+            kind_ = ShapeKind::ELLIPSE;
+            return word("ELLIPSE") && expect('(') && point() && expect(',') && point() && expect(',') &&
+                   number(parameter_) && expect(')');
+        }
+        kind_ = ShapeKind::CIRCLE;
+        return word("CIRCLE") && expect('(') && point() && expect(',') && number(parameter_) && expect(')');
+    }
+
+public:
+    explicit ShapeTextReader(std::istream &stream)
+            : source(stream.rdbuf()), buffer(TEXT_BUFFER_SIZE + TEXT_TOKEN_LENGTH) {}
+
+    // false at the end of input or at a malformed record, see failed()
+    bool next() {
+        if (invalid || peek() == 0) {
+            return false;
+        }
+        invalid = !parse();
+        return !invalid;
+    }
+
+    // true when reading stopped on a record that could not be parsed
+    bool failed() const {
+        return invalid;
+    }
+
+    ShapeKind kind() const {
+        return kind_;
+    }
+
+    // vertices of a polygon, the foci of an ellipse or the center of a circle
+    const std::vector<Point> &points() const {
+        return points_;
+    }
+
+    // the distance sum of an ellipse or the radius of a circle
+    double parameter() const {
+        return parameter_;
+    }
+
+    Polygon polygon() const {
+        return Polygon(points_);
+    }
+
+    Ellipse ellipse() const {
+        return Ellipse(points_[0], points_[1], parameter_);
+    }
+
+    Circle circle() const {
+        return Circle(points_[0], parameter_);
+    }
+};
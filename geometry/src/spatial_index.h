@@ -0,0 +1,406 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+
+#define RTREE_MAX_ENTRIES 16
+#define RTREE_MIN_ENTRIES 4
+
+/**
+ * R-tree over bounding boxes of shapes, identified by caller-chosen ids.
+ * build() bulk-loads with Sort-Tile-Recursive packing, which gives full nodes
+ * with little overlap; insert() and remove() keep the tree balanced in the
+ * classic Guttman way afterwards.
+ *
+ * Queries work on bounding boxes: a point query returns every shape whose box
+ * contains the point, so exact containment is left to the caller.
+ *
+ * Nodes live in one vector and refer to each other by index, so the tree is a
+ * few large allocations however many shapes it holds.
+ */
+class SpatialIndex {
+public:
+    struct Item {
+        BoundingBox box;
+        size_t id;
+    };
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        uint32_t parent;
+        uint32_t count;
+        bool leaf;
+        // in inner nodes id is the index of the child node
+        Item entries[RTREE_MAX_ENTRIES];
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = NONE;
+    size_t items = 0;
+
+    uint32_t newNode(bool leaf, uint32_t parent) {
+        uint32_t index;
+        if (!freeNodes.empty()) {
+            index = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            index = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        nodes[index].parent = parent;
+        nodes[index].count = 0;
+        nodes[index].leaf = leaf;
+        return index;
+    }
+
+    BoundingBox bounds(uint32_t node) const {
+        BoundingBox box = BoundingBox::empty();
+        for (uint32_t i = 0; i < nodes[node].count; ++i) {
+            box.extend(nodes[node].entries[i].box);
+        }
+        return box;
+    }
+
+    uint32_t slotOf(uint32_t node) const {
+        const Node &parent = nodes[nodes[node].parent];
+        uint32_t slot = 0;
+        while (parent.entries[slot].id != node) {
+            ++slot;
+        }
+        return slot;
+    }
+
+    void refreshUp(uint32_t node) {
+        while (nodes[node].parent != NONE) {
+            uint32_t parent = nodes[node].parent;
+            nodes[parent].entries[slotOf(node)].box = bounds(node);
+            node = parent;
+        }
+    }
+
+    // descends to the leaf whose box grows least when box is added
+    uint32_t chooseLeaf(const BoundingBox &box) const {
+        uint32_t node = root;
+        while (!nodes[node].leaf) {
+            const Node &current = nodes[node];
+            uint32_t best = 0;
+            double bestGrowth = std::numeric_limits<double>::infinity();
+            double bestArea = bestGrowth;
+            for (uint32_t i = 0; i < current.count; ++i) {
+                double area = current.entries[i].box.area();
+                double growth = current.entries[i].box.merged(box).area() - area;
+                if (growth < bestGrowth || (growth == bestGrowth && area < bestArea)) {
+                    best = i;
+                    bestGrowth = growth;
+                    bestArea = area;
+                }
+            }
+            node = static_cast<uint32_t>(current.entries[best].id);
+        }
+        return node;
+    }
+
+    // moves the upper half of node's entries and extra, ordered by center along
+    // the axis where the centers spread most, into a new sibling
+    uint32_t split(uint32_t node, const Item &extra) {
+        Item all[RTREE_MAX_ENTRIES + 1];
+        std::copy(nodes[node].entries, nodes[node].entries + RTREE_MAX_ENTRIES, all);
+        all[RTREE_MAX_ENTRIES] = extra;
+
+        BoundingBox centers = BoundingBox::empty();
+        for (const Item &item : all) {
+            centers.extend(item.box.center());
+        }
+        const bool byX = centers.maxX - centers.minX >= centers.maxY - centers.minY;
+        std::sort(all, all + RTREE_MAX_ENTRIES + 1, [byX](const Item &lhs, const Item &rhs) {
+            return byX ? lhs.box.minX + lhs.box.maxX < rhs.box.minX + rhs.box.maxX
+                       : lhs.box.minY + lhs.box.maxY < rhs.box.minY + rhs.box.maxY;
+        });
+
+        const uint32_t half = (RTREE_MAX_ENTRIES + 1) / 2;
+        uint32_t sibling = newNode(nodes[node].leaf, nodes[node].parent);
+        std::copy(all, all + half, nodes[node].entries);
+        nodes[node].count = half;
+        std::copy(all + half, all + RTREE_MAX_ENTRIES + 1, nodes[sibling].entries);
+        nodes[sibling].count = RTREE_MAX_ENTRIES + 1 - half;
+        if (!nodes[node].leaf) {
+            for (uint32_t i = 0; i < nodes[node].count; ++i) {
+                nodes[nodes[node].entries[i].id].parent = node;
+            }
+            for (uint32_t i = 0; i < nodes[sibling].count; ++i) {
+                nodes[nodes[sibling].entries[i].id].parent = sibling;
+            }
+        }
+        return sibling;
+    }
+
+    // adds an entry to node, splitting up the tree while nodes overflow
+    void addEntry(uint32_t node, const Item &entry) {
+        if (nodes[node].count < RTREE_MAX_ENTRIES) {
+            nodes[node].entries[nodes[node].count++] = entry;
+            if (!nodes[node].leaf) {
+                nodes[entry.id].parent = node;
+            }
+            refreshUp(node);
+            return;
+        }
+        uint32_t sibling = split(node, entry);
+        uint32_t parent = nodes[node].parent;
+        if (parent == NONE) {
+            root = newNode(false, NONE);
+            nodes[node].parent = root;
+            nodes[sibling].parent = root;
+            nodes[root].entries[0] = Item{bounds(node), node};
+            nodes[root].entries[1] = Item{bounds(sibling), sibling};
+            nodes[root].count = 2;
+            return;
+        }
+        nodes[parent].entries[slotOf(node)].box = bounds(node);
+        addEntry(parent, Item{bounds(sibling), sibling});
+    }
+
+    void insertItem(const Item &item) {
+        if (root == NONE) {
+            root = newNode(true, NONE);
+        }
+        addEntry(chooseLeaf(item.box), item);
+    }
+
+    // frees a detached subtree, keeping its shapes for reinsertion
+    void collect(uint32_t node, std::vector<Item> &orphans) {
+        for (uint32_t i = 0; i < nodes[node].count; ++i) {
+            if (nodes[node].leaf) {
+                orphans.push_back(nodes[node].entries[i]);
+            } else {
+                collect(static_cast<uint32_t>(nodes[node].entries[i].id), orphans);
+            }
+        }
+        freeNodes.push_back(node);
+    }
+
+    // after a removal from leaf: drops underfull nodes on the way up and
+    // reinserts their shapes, then shortens the tree if the root has one child
+    void condense(uint32_t node) {
+        std::vector<Item> orphans;
+        while (nodes[node].parent != NONE) {
+            uint32_t parent = nodes[node].parent;
+            uint32_t slot = slotOf(node);
+            if (nodes[node].count < RTREE_MIN_ENTRIES) {
+                Node &p = nodes[parent];
+                p.entries[slot] = p.entries[--p.count];
+                collect(node, orphans);
+            } else {
+                nodes[parent].entries[slot].box = bounds(node);
+            }
+            node = parent;
+        }
+        while (!nodes[root].leaf && nodes[root].count == 1) {
+            uint32_t child = static_cast<uint32_t>(nodes[root].entries[0].id);
+            freeNodes.push_back(root);
+            root = child;
+            nodes[root].parent = NONE;
+        }
+        if (nodes[root].count == 0) {
+            freeNodes.push_back(root);
+            root = NONE;
+        }
+        for (const Item &orphan : orphans) {
+            insertItem(orphan);
+        }
+    }
+
+    // packs one level of the tree: entries become children of new nodes,
+    // returned as the entries of the level above
+    std::vector<Item> pack(std::vector<Item> &entries, bool leaf, size_t threads) {
+        const size_t count = entries.size();
+        const size_t nodeCount = (count + RTREE_MAX_ENTRIES - 1) / RTREE_MAX_ENTRIES;
+        const size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+        const size_t sliceSize = slices * RTREE_MAX_ENTRIES;
+
+        detail::parallelSort(entries.begin(), entries.end(), [](const Item &lhs, const Item &rhs) {
+            return lhs.box.minX + lhs.box.maxX < rhs.box.minX + rhs.box.maxX;
+        }, threads);
+        detail::parallelFor(slices, threads, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; ++slice) {
+                auto first = entries.begin() + std::min(count, slice * sliceSize);
+                auto last = entries.begin() + std::min(count, (slice + 1) * sliceSize);
+                std::sort(first, last, [](const Item &lhs, const Item &rhs) {
+                    return lhs.box.minY + lhs.box.maxY < rhs.box.minY + rhs.box.maxY;
+                });
+            }
+        }, 1);
+
+        const uint32_t firstNode = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + nodeCount);
+        std::vector<Item> level(nodeCount);
+        detail::parallelFor(nodeCount, threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t index = firstNode + static_cast<uint32_t>(i);
+                Node &node = nodes[index];
+                node.parent = NONE;
+                node.leaf = leaf;
+                node.count = static_cast<uint32_t>(std::min<size_t>(RTREE_MAX_ENTRIES, count - i * RTREE_MAX_ENTRIES));
+                std::copy(entries.begin() + i * RTREE_MAX_ENTRIES,
+                          entries.begin() + i * RTREE_MAX_ENTRIES + node.count, node.entries);
+                if (!leaf) {
+                    for (uint32_t j = 0; j < node.count; ++j) {
+                        nodes[node.entries[j].id].parent = index;
+                    }
+                }
+                level[i] = Item{bounds(index), index};
+            }
+        }, 1024);
+        return level;
+    }
+
+public:
+    size_t size() const {
+        return items;
+    }
+
+    bool empty() const {
+        return items == 0;
+    }
+
+    void clear() {
+        nodes.clear();
+        freeNodes.clear();
+        root = NONE;
+        items = 0;
+    }
+
+    // replaces the contents of the index
+    void build(std::vector<Item> entries, size_t threads = 1) {
+        clear();
+        items = entries.size();
+        if (entries.empty()) {
+            return;
+        }
+        nodes.reserve(entries.size() / (RTREE_MAX_ENTRIES - 1) + 16);
+        std::vector<Item> level = pack(entries, true, threads);
+        while (level.size() > 1) {
+            level = pack(level, false, threads);
+        }
+        root = static_cast<uint32_t>(level[0].id);
+    }
+
+    // shapes[i] gets id i; boxes are computed on up to threads threads
+    void build(const std::vector<const Shape *> &shapes, size_t threads = 1) {
+        std::vector<Item> entries(shapes.size());
+        detail::parallelFor(shapes.size(), threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                entries[i] = Item{shapes[i]->boundingBox(), i};
+            }
+        }, 4096);
+        build(std::move(entries), threads);
+    }
+
+    void insert(const BoundingBox &box, size_t id) {
+        insertItem(Item{box, id});
+        ++items;
+    }
+
+    void insert(const Shape &shape, size_t id) {
+        insert(shape.boundingBox(), id);
+    }
+
+    // box must be the one the shape was inserted with; false if id is absent
+    bool remove(const BoundingBox &box, size_t id) {
+        if (root == NONE) {
+            return false;
+        }
+        std::vector<uint32_t> stack = {root};
+        while (!stack.empty()) {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            Node &current = nodes[node];
+            for (uint32_t i = 0; i < current.count; ++i) {
+                if (!current.entries[i].box.contains(box)) {
+                    continue;
+                }
+                if (!current.leaf) {
+                    stack.push_back(static_cast<uint32_t>(current.entries[i].id));
+                } else if (current.entries[i].id == id) {
+                    current.entries[i] = current.entries[--current.count];
+                    --items;
+                    condense(node);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // the shape must not have been transformed since it was inserted
+    bool remove(const Shape &shape, size_t id) {
+        return remove(shape.boundingBox(), id);
+    }
+
+    // ids of shapes whose boxes contain p
+    void query(const Point &p, std::vector<size_t> &out) const {
+        query(BoundingBox{p.x, p.y, p.x, p.y}, out);
+    }
+
+    // ids of shapes whose boxes intersect box
+    void query(const BoundingBox &box, std::vector<size_t> &out) const {
+        out.clear();
+        if (root == NONE) {
+            return;
+        }
+        std::vector<uint32_t> stack = {root};
+        while (!stack.empty()) {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+            for (uint32_t i = 0; i < node.count; ++i) {
+                if (node.entries[i].box.intersects(box)) {
+                    if (node.leaf) {
+                        out.push_back(node.entries[i].id);
+                    } else {
+                        stack.push_back(static_cast<uint32_t>(node.entries[i].id));
+                    }
+                }
+            }
+        }
+    }
+
+    // ids of the k shapes whose boxes are closest to p, nearest first
+    void nearest(const Point &p, size_t k, std::vector<size_t> &out) const {
+        out.clear();
+        if (root == NONE || k == 0) {
+            return;
+        }
+        struct Candidate {
+            double distance2;
+            size_t value;
+            bool item;
+
+            bool operator>(const Candidate &other) const {
+                return distance2 > other.distance2;
+            }
+        };
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+        queue.push(Candidate{0.0, root, false});
+        while (!queue.empty() && out.size() < k) {
+            Candidate next = queue.top();
+            queue.pop();
+            if (next.item) {
+                out.push_back(next.value);
+                continue;
+            }
+            const Node &node = nodes[next.value];
+            for (uint32_t i = 0; i < node.count; ++i) {
+                queue.push(Candidate{node.entries[i].box.distance2(p), node.entries[i].id, node.leaf});
+            }
+        }
+    }
+};
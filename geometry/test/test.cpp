@@ -1,6 +1,12 @@
 #include "geometry.h"
+#include "polygon_ops.h"
+#include "shape_io.h"
+#include "shape_batch.h"
+#include "spatial_index.h"
 
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <vector>
 #include <sstream>
 #include <iostream>
@@ -15,6 +21,10 @@ bool equals(double a, double b, double eps = 1e-6) {
     return a-b <= eps && b-a <= eps;
 }
 
+bool equals(const Point& a, const Point& b) {
+    return equals(a.x, b.x) && equals(a.y, b.y);
+}
+
 int main() {
 
     const int ax = -2, ay = 2, bx = 1, by = 2,
@@ -122,8 +132,8 @@ int main() {
         double e = c/a;
         double per = 4*a*1.34050538; // std::comp_ellint_2
         double b =  a*sqrt(1-e*e);
-        const double PI = 3.14159265;
-        double ar = PI*a*b;
+        const double pi = 3.14159265;
+        double ar = pi*a*b;
         //std::cerr << "XXXXXXXXX " << cf5.eccentricity() << ' ' << e << '\n';
         //std::cerr << "XXXXXXXXX " << cf5.perimeter() << ' ' << per << '\n';
         //std::cerr << "XXXXXXXXX " << cf5.area() << ' ' << ar << '\n';
@@ -185,5 +195,701 @@ int main() {
         }
     }
 
+    // Value semantics: copies are independent and transform in place
+    {
+        Polygon square({Point(0, 0), Point(2, 0), Point(2, 2), Point(0, 2)});
+        Polygon copy = square;
+        copy.rotate(Point(0, 0), 90);
+        if (!equals(copy.getVertices()[1].y, 2) || square.getVertices()[1].y != 0) {
+            std::cerr << "Test 11.0 failed. (polygon copies)\n";
+            return 1;
+        }
+        copy.scale(Point(0, 0), -3);
+        Polygon moved = std::move(copy);
+        if (!equals(moved.area(), 36) || !equals(moved.perimeter(), 24)) {
+            std::cerr << "Test 11.1 failed. (moved polygon)\n";
+            return 1;
+        }
+
+        Ellipse ellipse(Point(0, 0), Point(2, 0), 4);
+        Ellipse turned = ellipse;
+        turned.rotate(Point(0, 0), 90);
+        if (!equals(turned.focuses().second.y, 2) || ellipse.focuses().second.y != 0) {
+            std::cerr << "Test 11.2 failed. (ellipse copies)\n";
+            return 1;
+        }
+
+        Circle circle(Point(0, 0), 2);
+        circle.rotate(Point(0.5, 0.5), 180);
+        circle.scale(Point(0, 0), -2);
+        if (!equals(circle.center().x, -2) || !equals(circle.center().y, -2) || !equals(circle.radius(), 4) ||
+            circle == square) {
+            std::cerr << "Test 11.3 failed. (circle transformations)\n";
+            return 1;
+        }
+
+        bool thrown = false;
+        try {
+            Polygon segment({Point(0, 0), Point(1, 1)});
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        if (!thrown) {
+            std::cerr << "Test 11.4 failed. (polygon with two vertices)\n";
+            return 1;
+        }
+    }
+
+    // ShapeBatch: bulk transforms agree with transforming every shape
+    {
+        std::vector<Polygon> polygons = {Polygon({a, b, f, c, e, d}), Polygon({a, b, d}), Polygon({c, k, f, b, e})};
+        std::vector<Ellipse> ellipses = {Ellipse(c, f, 5), Ellipse(a, e, 6)};
+        std::vector<Circle> circles = {Circle(b, 3), Circle(d, 0.5)};
+        ShapeBatch batch;
+        for (const Polygon &polygon : polygons) {
+            batch.add(polygon);
+        }
+        for (const Ellipse &ellipse : ellipses) {
+            batch.add(ellipse);
+        }
+        for (const Circle &circle : circles) {
+            batch.add(circle);
+        }
+
+        auto transform = [](auto &shape) {
+            shape.rotate(Point(1, 2), 33);
+            shape.scale(Point(-1, 0.5), -1.7);
+            shape.reflex(Line(0.7, -2));
+            shape.reflex(Point(3, 3));
+        };
+        transform(batch);
+        std::vector<const Shape *> shapes;
+        for (Polygon &polygon : polygons) {
+            transform(polygon);
+            shapes.push_back(&polygon);
+        }
+        for (Ellipse &ellipse : ellipses) {
+            transform(ellipse);
+            shapes.push_back(&ellipse);
+        }
+        for (Circle &circle : circles) {
+            transform(circle);
+            shapes.push_back(&circle);
+        }
+
+        std::vector<double> areas, perimeters;
+        batch.areas(areas);
+        batch.perimeters(perimeters);
+        if (batch.size() != shapes.size() || !batch.isPolygon(0) || !batch.isEllipse(3) || !batch.isCircle(5)) {
+            std::cerr << "Test 12.0 failed. (batch layout)\n";
+            return 1;
+        }
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            if (!equals(areas[i], shapes[i]->area()) || !equals(perimeters[i], shapes[i]->perimeter())) {
+                std::cerr << "Test 12.1 failed. (batch area or perimeter)\n";
+                return 1;
+            }
+        }
+        for (size_t i = 0; i < polygons.size(); ++i) {
+            const std::vector<Point> &expected = polygons[i].getVertices();
+            Polygon polygon = batch.polygon(i);
+            for (size_t j = 0; j < expected.size(); ++j) {
+                if (!equals(polygon.getVertices()[j], expected[j])) {
+                    std::cerr << "Test 12.2 failed. (batch polygon)\n";
+                    return 1;
+                }
+            }
+        }
+        if (!equals(batch.ellipse(3).focuses().first, ellipses[0].focuses().first) ||
+            !equals(batch.ellipse(4).focuses().second, ellipses[1].focuses().second) ||
+            !equals(batch.circle(5).center(), circles[0].center()) || !equals(batch.circle(6).radius(), circles[1].radius())) {
+            std::cerr << "Test 12.3 failed. (batch ellipse or circle)\n";
+            return 1;
+        }
+    }
+
+    // Transform: a composed transform matches the operations one by one
+    {
+        Polygon stepwise({a, b, f, c, e, d});
+        Polygon composed = stepwise;
+        Ellipse ellipse(c, f, 5);
+        Ellipse composedEllipse = ellipse;
+        Point point = k;
+        Point composedPoint = k;
+
+        stepwise.rotate(Point(1, 2), 33);
+        stepwise.scale(Point(-1, 0.5), -1.7);
+        stepwise.reflex(Line(0.7, -2));
+        stepwise.reflex(Point(3, 3));
+        ellipse.scale(Point(1, 1), 2);
+        ellipse.rotate(Point(0, 0), 45);
+        point.rotate(Point(3, 4), 77);
+
+        Transform transform = Transform::rotation(Point(1, 2), 33)
+                .then(Transform::scaling(Point(-1, 0.5), -1.7))
+                .then(Transform::reflection(Line(0.7, -2)))
+                .then(Transform::reflection(Point(3, 3)));
+        composed.apply(transform);
+        composedEllipse.apply(Transform::scaling(Point(1, 1), 2).then(Transform::rotation(Point(0, 0), 45)));
+        composedPoint.apply(Transform::rotation(Point(3, 4), 77));
+
+        for (size_t i = 0; i < stepwise.verticesCount(); ++i) {
+            if (!equals(composed.getVertices()[i], stepwise.getVertices()[i])) {
+                std::cerr << "Test 13.0 failed. (composed polygon transform)\n";
+                return 1;
+            }
+        }
+        if (!equals(composedEllipse.focuses().first, ellipse.focuses().first) ||
+            !equals(composedEllipse.focuses().second, ellipse.focuses().second) ||
+            !equals(composedEllipse.area(), ellipse.area()) || !equals(composedPoint, point)) {
+            std::cerr << "Test 13.1 failed. (composed ellipse or point transform)\n";
+            return 1;
+        }
+        if (!equals(transform.lengthFactor(), 1.7) || !transform.reverses() || !Transform().keepsAxes()) {
+            std::cerr << "Test 13.2 failed. (transform properties)\n";
+            return 1;
+        }
+    }
+
+    // SpatialIndex: queries match a linear scan through inserts and removals
+    {
+        std::vector<SpatialIndex::Item> items;
+        for (size_t i = 0; i < 900; ++i) {
+            double x = 2.0 * (i % 30);
+            double y = 2.0 * (i / 30) + 0.1 * (i % 7);
+            items.push_back({BoundingBox{x, y, x + 1.5, y + 1.0}, i});
+        }
+        SpatialIndex index;
+        index.build(items, 2);
+        for (size_t i = 0; i < 200; ++i) {
+            double x = 0.3 * i;
+            double y = 60.0 - 0.25 * i;
+            items.push_back({BoundingBox{x, y, x + 3.0, y + 0.5}, items.size()});
+            index.insert(items.back().box, items.back().id);
+        }
+        // removing most of the tree empties nodes and reinserts their orphans
+        std::vector<bool> removed(items.size(), false);
+        for (size_t i = 0; i < items.size(); i += 1 + i % 3) {
+            if (!index.remove(items[i].box, items[i].id) || index.remove(items[i].box, items[i].id)) {
+                std::cerr << "Test 14.0 failed. (spatial index removal)\n";
+                return 1;
+            }
+            removed[i] = true;
+        }
+        size_t left = std::count(removed.begin(), removed.end(), false);
+        if (index.size() != left) {
+            std::cerr << "Test 14.1 failed. (spatial index size)\n";
+            return 1;
+        }
+
+        auto scan = [&](auto matches) {
+            std::vector<size_t> res;
+            for (const SpatialIndex::Item &item : items) {
+                if (!removed[item.id] && matches(item.box)) {
+                    res.push_back(item.id);
+                }
+            }
+            return res;
+        };
+        for (double x = -1.0; x < 60.0; x += 3.7) {
+            BoundingBox window{x, x - 5.0, x + 6.0, x + 4.0};
+            Point p = items[static_cast<size_t>(x * 37 + 40) % items.size()].box.center();
+            std::vector<size_t> found;
+            index.query(p, found);
+            std::sort(found.begin(), found.end());
+            std::vector<size_t> expectedAtPoint = scan([&](const BoundingBox &box) { return box.contains(p); });
+            if (found != expectedAtPoint) {
+                std::cerr << "Test 14.2 failed. (spatial index point query)\n";
+                return 1;
+            }
+            index.query(window, found);
+            std::sort(found.begin(), found.end());
+            if (found != scan([&](const BoundingBox &box) { return box.intersects(window); })) {
+                std::cerr << "Test 14.3 failed. (spatial index box query)\n";
+                return 1;
+            }
+
+            index.nearest(p, 5, found);
+            std::vector<double> distances;
+            for (size_t id : scan([](const BoundingBox &) { return true; })) {
+                distances.push_back(items[id].box.distance2(p));
+            }
+            std::sort(distances.begin(), distances.end());
+            for (size_t i = 0; i < 5; ++i) {
+                if (found.size() != 5 || items[found[i]].box.distance2(p) != distances[i]) {
+                    std::cerr << "Test 14.4 failed. (spatial index nearest)\n";
+                    return 1;
+                }
+            }
+        }
+
+        for (const SpatialIndex::Item &item : items) {
+            if (!removed[item.id]) {
+                index.remove(item.box, item.id);
+            }
+        }
+        std::vector<size_t> found;
+        index.query(BoundingBox{-100, -100, 100, 100}, found);
+        if (!index.empty() || !found.empty()) {
+            std::cerr << "Test 14.5 failed. (emptied spatial index)\n";
+            return 1;
+        }
+
+        std::vector<const Shape *> shapes = {&b3, &abfced, &cf5};
+        index.build(shapes);
+        index.query(b3.center(), found);
+        if (std::find(found.begin(), found.end(), 0) == found.end()) {
+            std::cerr << "Test 14.6 failed. (spatial index over shapes)\n";
+            return 1;
+        }
+    }
+
+    // Containment: winding numbers, and batched tests agree with single ones
+    {
+        // a U open at the top, walked clockwise
+        Polygon cup({Point(0, 0), Point(0, 3), Point(1, 3), Point(1, 1), Point(2, 1), Point(2, 3), Point(3, 3), Point(3, 0)});
+        if (!cup.containsPoint(Point(0.5, 2.5)) || !cup.containsPoint(Point(1.5, 0.5)) ||
+            cup.containsPoint(Point(1.5, 2)) || cup.containsPoint(Point(3.5, 1))) {
+            std::cerr << "Test 15.0 failed. (point in concave polygon)\n";
+            return 1;
+        }
+        // the unit square walked twice has winding number 2 inside
+        Polygon twice({Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1),
+                       Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1)});
+        if (!twice.containsPoint(Point(0.5, 0.5)) || twice.containsPoint(Point(2, 0.5))) {
+            std::cerr << "Test 15.1 failed. (winding number)\n";
+            return 1;
+        }
+        Ellipse ellipse(Point(-1, 0), Point(1, 0), 4);
+        if (!ellipse.containsPoint(Point(2, 0)) || !ellipse.containsPoint(Point(0, 1.7)) ||
+            ellipse.containsPoint(Point(0, 1.8))) {
+            std::cerr << "Test 15.2 failed. (point in ellipse)\n";
+            return 1;
+        }
+
+        // more points than one block, so the blocks are checked too
+        std::vector<Point> points;
+        for (int i = 0; i < 3000; ++i) {
+            points.emplace_back(-2 + 0.37 * (i % 40), -3 + 0.29 * (i / 40 % 30) + 0.001 * i);
+        }
+        std::vector<const Shape *> shapes = {&cup, &twice, &ellipse, &abfced, &abd, &b3, &cf5};
+        for (const Shape *shape : shapes) {
+            std::vector<char> inside;
+            shape->containsPoints(points, inside);
+            size_t count = 0;
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (inside[i] != shape->containsPoint(points[i])) {
+                    std::cerr << "Test 15.3 failed. (batched containment)\n";
+                    return 1;
+                }
+                count += inside[i];
+            }
+            if (count == 0) {
+                std::cerr << "Test 15.4 failed. (no points inside)\n";
+                return 1;
+            }
+        }
+    }
+
+    // Convex hull, clipping and segment intersections
+    {
+        std::vector<Point> points = {a, b, c, d, e, f, k, Point(0, 0), Point(2, 0.5), Point(-1, 2), Point(1, 0.5)};
+        Polygon hull = convexHull(points);
+        if (hull != Polygon({a, b, f, c, d}) || !isConvex(hull) || isConvex(abfced)) {
+            std::cerr << "Test 16.0 failed. (convex hull)\n";
+            return 1;
+        }
+
+        Polygon square({Point(0, 0), Point(2, 0), Point(2, 2), Point(0, 2)});
+        Polygon lshape({Point(0, 0), Point(3, 0), Point(3, 1), Point(1, 1), Point(1, 3), Point(0, 3)});
+        std::vector<Polygon> common = intersect(square, lshape);
+        std::vector<Polygon> both = unite(square, lshape);
+        if (common.size() != 1 || !equals(common[0].area(), 3) || both.size() != 1 || !equals(both[0].area(), 6)) {
+            std::cerr << "Test 16.1 failed. (concave clipping)\n";
+            return 1;
+        }
+        // a bar over the open top of a U leaves a hole
+        Polygon cup({Point(0, 0), Point(3, 0), Point(3, 3), Point(2, 3), Point(2, 1), Point(1, 1), Point(1, 3), Point(0, 3)});
+        Polygon bar({Point(-1, 2), Point(4, 2), Point(4, 4), Point(-1, 4)});
+        both = unite(cup, bar);
+        if (both.size() != 2 || !equals(both[0].area() + both[1].area(), 17) ||
+            !equals(fabs(both[0].area() - both[1].area()), 15)) {
+            std::cerr << "Test 16.2 failed. (union with a hole)\n";
+            return 1;
+        }
+        both = unite(cup, cup);
+        common = intersect(cup, cup);
+        if (both.size() != 1 || both[0] != cup || common.size() != 1 || common[0] != cup) {
+            std::cerr << "Test 16.3 failed. (clipping a polygon with itself)\n";
+            return 1;
+        }
+
+        // shared edges merge in a union and give nothing in an intersection
+        Polygon left({Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1)});
+        Polygon right({Point(1, 0), Point(2, 0), Point(2, 1), Point(1, 1)});
+        both = unite(left, right);
+        if (both.size() != 1 || both[0] != Polygon({Point(0, 0), Point(2, 0), Point(2, 1), Point(0, 1)}) ||
+            !intersect(left, right).empty()) {
+            std::cerr << "Test 16.4 failed. (polygons sharing an edge)\n";
+            return 1;
+        }
+        // the same along two edges of the inner corner of an L
+        Polygon corner({Point(1, 1), Point(2, 1), Point(2, 2), Point(1, 2)});
+        both = unite(lshape, corner);
+        if (both.size() != 1 || !equals(both[0].area(), 6) || !intersect(lshape, corner).empty()) {
+            std::cerr << "Test 16.5 failed. (polygons sharing two edges)\n";
+            return 1;
+        }
+        // polygons touching at a vertex stay apart
+        Polygon diagonal({Point(1, 1), Point(2, 1), Point(2, 2), Point(1, 2)});
+        both = unite(left, diagonal);
+        if (both.size() != 2 || !equals(both[0].area(), 1) || !equals(both[1].area(), 1) ||
+            !intersect(left, diagonal).empty()) {
+            std::cerr << "Test 16.6 failed. (polygons touching at a vertex)\n";
+            return 1;
+        }
+        Polygon wedge({Point(2, 0), Point(1, -1), Point(3, -1)});
+        if (unite(lshape, wedge).size() != 2 || !intersect(lshape, wedge).empty()) {
+            std::cerr << "Test 16.7 failed. (vertex touching an edge)\n";
+            return 1;
+        }
+
+        std::vector<Segment> segments = {Segment{Point(0, 0), Point(2, 2)}, Segment{Point(0, 2), Point(2, 0)},
+                                         Segment{Point(2, 2), Point(3, 0)}, Segment{Point(5, 5), Point(6, 6)},
+                                         Segment{Point(5.5, 5.5), Point(7, 7)}, Segment{Point(3, 3), Point(4, 3)}};
+        std::vector<SegmentIntersection> crossings = segmentIntersections(segments);
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (const SegmentIntersection &crossing : crossings) {
+            pairs.emplace_back(crossing.first, crossing.second);
+            if (crossing.first == 0 && crossing.second == 1 && crossing.point != Point(1, 1)) {
+                std::cerr << "Test 16.8 failed. (segment intersection point)\n";
+                return 1;
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+        if (pairs != std::vector<std::pair<size_t, size_t>>{{0, 1}, {0, 2}, {3, 4}}) {
+            std::cerr << "Test 16.9 failed. (segment intersections)\n";
+            return 1;
+        }
+    }
+
+    // Congruence and similarity
+    {
+        Polygon house({Point(0, 0), Point(4, 0), Point(4, 3), Point(2, 5), Point(0, 3)});
+        Polygon moved = house;
+        moved.rotate(Point(1, 1), 50);
+        moved.scale(Point(1, 1), 3);
+        if (moved == house || !moved.isSimilarTo(house) || moved.isCongruentTo(house)) {
+            std::cerr << "Test 17.0 failed. (similar polygons)\n";
+            return 1;
+        }
+        moved.scale(Point(1, 1), 1. / 3);
+        moved.reflex(Line(3, 5));
+        Polygon fresh(moved.getVertices());
+        if (!moved.isCongruentTo(house) || !house.isCongruentTo(moved) || !fresh.isCongruentTo(house)) {
+            std::cerr << "Test 17.1 failed. (congruent polygons)\n";
+            return 1;
+        }
+
+        // a chiral L is congruent to its mirror image but not to a taller L
+        Polygon lshape({Point(0, 0), Point(3, 0), Point(3, 1), Point(1, 1), Point(1, 2), Point(0, 2)});
+        Polygon taller({Point(0, 0), Point(3, 0), Point(3, 1), Point(1, 1), Point(1, 2.5), Point(0, 2.5)});
+        Polygon mirrored = lshape;
+        mirrored.reflex(Line(0.3, 1));
+        if (!lshape.isCongruentTo(mirrored) || lshape.isSimilarTo(taller)) {
+            std::cerr << "Test 17.2 failed. (chiral polygons)\n";
+            return 1;
+        }
+        // a vertex in the middle of an edge changes equality but not the shape
+        Polygon square({Point(0, 0), Point(2, 0), Point(2, 2), Point(0, 2)});
+        Polygon splitSide({Point(0, 0), Point(1, 0), Point(2, 0), Point(2, 2), Point(0, 2)});
+        if (!square.isCongruentTo(splitSide) || square == splitSide || !square.isSimilarTo(sq_ae) ||
+            square.isSimilarTo(Rectangle(Point(0, 0), Point(4, 2), 2))) {
+            std::cerr << "Test 17.3 failed. (squares and rectangles)\n";
+            return 1;
+        }
+
+        Ellipse ellipse(Point(0, 0), Point(4, 0), 6);
+        Ellipse turned = ellipse;
+        turned.rotate(Point(7, 1), 33);
+        Ellipse larger = turned;
+        larger.scale(Point(0, 0), 2);
+        if (ellipse != Ellipse(Point(4, 0), Point(0, 0), 6) || turned == ellipse || !turned.isCongruentTo(ellipse) ||
+            larger.isCongruentTo(ellipse) || !larger.isSimilarTo(ellipse)) {
+            std::cerr << "Test 17.4 failed. (ellipses)\n";
+            return 1;
+        }
+        Circle circle(Point(1, 1), 2);
+        if (circle != Ellipse(Point(1, 1), Point(1, 1), 4) || !circle.isCongruentTo(Circle(Point(5, 5), 2)) ||
+            circle == square || circle.isSimilarTo(square) || square.isSimilarTo(ellipse)) {
+            std::cerr << "Test 17.5 failed. (circles)\n";
+            return 1;
+        }
+        if (Point(0.1 + 0.2, 0) != Point(0.3, 0) || Point(1e12 + 1e-3, 0) != Point(1e12, 0) ||
+            Point(1, 0) == Point(1 + 1e-5, 0)) {
+            std::cerr << "Test 17.6 failed. (relative tolerance)\n";
+            return 1;
+        }
+
+        // vertices merge relative to the polygon's size, not its position
+        Polygon tinyTriangle({Point(0, 0), Point(4e-7, 0), Point(2e-7, 3.4641e-7)});
+        Polygon tinySquare({Point(0, 0), Point(5e-7, 0), Point(5e-7, 5e-7), Point(0, 5e-7)});
+        Polygon tinierSquare({Point(1, 1), Point(1 + 4e-7, 1), Point(1 + 4e-7, 1 + 4e-7), Point(1, 1 + 4e-7)});
+        if (tinyTriangle.isCongruentTo(tinySquare) || tinyTriangle.isSimilarTo(tinySquare) ||
+            !tinySquare.isSimilarTo(tinierSquare) || tinySquare.isCongruentTo(tinierSquare)) {
+            std::cerr << "Test 17.7 failed. (tiny polygons)\n";
+            return 1;
+        }
+        Polygon farSquare({Point(5e6, 5e6), Point(5e6 + 1, 5e6), Point(5e6 + 1, 5e6 + 1), Point(5e6, 5e6 + 1)});
+        Polygon farTriangle({Point(5e6, 5e6), Point(5e6 + 1, 5e6), Point(5e6, 5e6 + 1)});
+        Polygon unitSquare({Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1)});
+        if (farSquare.isSimilarTo(farTriangle) || !farSquare.isCongruentTo(unitSquare) ||
+            !unitSquare.isSimilarTo(farSquare)) {
+            std::cerr << "Test 17.8 failed. (polygons far from the origin)\n";
+            return 1;
+        }
+        Polygon collapsed({Point(1, 2), Point(1, 2), Point(1, 2)});
+        if (collapsed.isSimilarTo(Polygon({Point(3, 3), Point(3, 3), Point(3, 3), Point(3, 3)})) ||
+            collapsed.isCongruentTo(collapsed)) {
+            std::cerr << "Test 17.9 failed. (polygons without area)\n";
+            return 1;
+        }
+        Polygon farHull = convexHull({Point(5e6, 5e6), Point(5e6 + 3, 5e6), Point(5e6 + 3, 5e6 + 3),
+                                      Point(5e6, 5e6 + 3), Point(5e6 + 1, 5e6 + 1)});
+        if (farHull.verticesCount() != 4 || !equals(farHull.area(), 9.0)) {
+            std::cerr << "Test 17.10 failed. (hull far from the origin)\n";
+            return 1;
+        }
+    }
+
+    // Cached measures follow transforms and match freshly computed ones
+    {
+        Polygon polygon({a, b, f, c, e, d});
+        Ellipse ellipse(c, f, 7);
+        for (int i = 0; i < 12; ++i) {
+            // warm the caches before some of the transforms only
+            if (i % 3 != 2) {
+                polygon.area();
+                polygon.perimeter();
+                polygon.centroid();
+                polygon.boundingBox();
+                ellipse.perimeter();
+                ellipse.boundingBox();
+            }
+            switch (i % 4) {
+                case 0:
+                    polygon.rotate(Point(1, -1), 35);
+                    ellipse.rotate(Point(1, 2), 30);
+                    break;
+                case 1:
+                    polygon.scale(Point(2, 3), -1.5);
+                    ellipse.scale(Point(0, 0), 0.7);
+                    break;
+                case 2:
+                    polygon.reflex(Line(0.5, 1));
+                    ellipse.reflex(Line(Point(1, 1), Point(2, 5)));
+                    break;
+                default:
+                    polygon.rotate(Point(0, 0), 90);
+                    ellipse.reflex(Point(1, 1));
+                    break;
+            }
+
+            Polygon fresh(polygon.getVertices());
+            Ellipse freshEllipse(ellipse.focuses().first, ellipse.focuses().second, 2 * ellipse.semiMajorAxis());
+            BoundingBox box = polygon.boundingBox();
+            BoundingBox freshBox = fresh.boundingBox();
+            BoundingBox ellipseBox = ellipse.boundingBox();
+            BoundingBox freshEllipseBox = freshEllipse.boundingBox();
+            if (!equals(polygon.area(), fresh.area()) || !equals(polygon.perimeter(), fresh.perimeter()) ||
+                polygon.centroid() != fresh.centroid()) {
+                std::cerr << "Test 18.0 failed. (cached polygon measures)\n";
+                return 1;
+            }
+            if (!equals(box.minX, freshBox.minX) || !equals(box.minY, freshBox.minY) ||
+                !equals(box.maxX, freshBox.maxX) || !equals(box.maxY, freshBox.maxY)) {
+                std::cerr << "Test 18.1 failed. (cached polygon bounding box)\n";
+                return 1;
+            }
+            if (!equals(ellipse.perimeter(), freshEllipse.perimeter()) ||
+                !equals(ellipseBox.minX, freshEllipseBox.minX) || !equals(ellipseBox.minY, freshEllipseBox.minY) ||
+                !equals(ellipseBox.maxX, freshEllipseBox.maxX) || !equals(ellipseBox.maxY, freshEllipseBox.maxY)) {
+                std::cerr << "Test 18.2 failed. (cached ellipse measures)\n";
+                return 1;
+            }
+        }
+
+        Polygon flat({Point(0, 0), Point(1, 0), Point(2, 0)});
+        if (Triangle(Point(0, 0), Point(3, 0), Point(0, 3)).centroid() != Point(1, 1) || flat.centroid() != Point(1, 0)) {
+            std::cerr << "Test 18.3 failed. (centroid)\n";
+            return 1;
+        }
+    }
+
+    // Line: vertical lines and the batched operations
+    {
+        Line vertical(Point(2, -1), Point(2, 5));
+        Point reflected(5, 3);
+        reflected.reflex(vertical);
+        if (reflected != Point(-1, 3) || !equals(fabs(vertical.signedDistance(Point(7, 0))), 5) ||
+            vertical.intersection(Line(0, 4)) != Point(2, 4) || vertical != Line(Point(2, 9), Point(2, -3))) {
+            std::cerr << "Test 19.0 failed. (vertical line)\n";
+            return 1;
+        }
+        Polygon square({Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1)});
+        square.reflex(vertical);
+        if (square != Polygon({Point(4, 0), Point(3, 0), Point(3, 1), Point(4, 1)})) {
+            std::cerr << "Test 19.1 failed. (reflection in a vertical line)\n";
+            return 1;
+        }
+        if (Line(1, 1) != Line(Point(0, 1), Point(1, 2)) || Line(1, 1) != Line(Point(0, 1), 1.0) ||
+            Line(1, 1) != Line(-2, 2, -2) || Line(1, 1) == Line(1, 1.1) ||
+            !equals(line1.k(), 3) || !equals(line1.b(), 5)) {
+            std::cerr << "Test 19.2 failed. (line forms)\n";
+            return 1;
+        }
+        // y = kx + b reflects (x, y) to ((1 - k^2) x + 2k (y - b), (k^2 - 1) y + 2kx + 2b) / (k^2 + 1)
+        Point q(4, -3);
+        Point byFormula(((1 - 9) * q.x + 2 * 3 * (q.y - 5)) / 10, ((9 - 1) * q.y + 2 * 3 * q.x + 2 * 5) / 10);
+        Point byLine = q;
+        byLine.reflex(line1);
+        if (byLine != byFormula || Transform::reflection(line1)(q) != byFormula) {
+            std::cerr << "Test 19.3 failed. (reflection in y = kx + b)\n";
+            return 1;
+        }
+
+        std::vector<Point> points;
+        std::vector<Line> lines = {vertical, line1, ae, Line(0, 4)};
+        for (int i = 0; i < 37; ++i) {
+            points.emplace_back(0.7 * i - 9, 5 - 0.3 * i * (i % 4));
+            lines.emplace_back(points.back(), Point(i % 5, 3 - i % 7));
+        }
+        std::vector<Point> mirrored(points.size(), Point(0, 0));
+        std::vector<Point> hits(lines.size(), Point(0, 0));
+        std::vector<double> distances(points.size());
+        line2.reflect(points.data(), points.size(), mirrored.data());
+        line2.signedDistances(points.data(), points.size(), distances.data());
+        line2.intersect(lines.data(), lines.size(), hits.data());
+        for (size_t i = 0; i < points.size(); ++i) {
+            Point single = points[i];
+            single.reflex(line2);
+            if (single != mirrored[i] || !equals(distances[i], line2.signedDistance(points[i])) ||
+                !equals(points[i].distance(mirrored[i]), 2 * fabs(distances[i]))) {
+                std::cerr << "Test 19.4 failed. (batched reflection or distance)\n";
+                return 1;
+            }
+        }
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (hits[i] != line2.intersection(lines[i]) || !equals(lines[i].signedDistance(hits[i]), 0)) {
+                std::cerr << "Test 19.5 failed. (batched intersection)\n";
+                return 1;
+            }
+        }
+        Point parallel = line2.intersection(Line(Point(0, 0), -1.5));
+        if (std::isfinite(parallel.x) && std::isfinite(parallel.y)) {
+            std::cerr << "Test 19.6 failed. (parallel lines)\n";
+            return 1;
+        }
+    }
+
+    // Shape files: binary records read back through a mapping, and text
+    {
+        Polygon polygon({a, b, f, c, e, d});
+        polygon.rotate(Point(0.3, 0.7), 21);
+        Ellipse ellipse(c, f, 5.5);
+        Circle circle(Point(1.5, -2), 1. / 3);
+        std::vector<const Shape *> shapes = {&polygon, &ellipse, &circle, &abd, &rec_ae1};
+
+        const char *path = "/tmp/geometry_test_shapes.bin";
+        {
+            std::ofstream out(path, std::ios::binary);
+            ShapeWriter writer(out);
+            for (const Shape *shape : shapes) {
+                writer.write(*shape);
+            }
+        }
+        {
+            MappedShapes mapped(path);
+            if (mapped.size() != shapes.size() || mapped.kind(0) != ShapeKind::POLYGON ||
+                mapped.kind(1) != ShapeKind::ELLIPSE || mapped.kind(2) != ShapeKind::CIRCLE) {
+                std::cerr << "Test 20.0 failed. (mapped shape kinds)\n";
+                return 1;
+            }
+            PolygonView view = mapped.polygon(0);
+            if (view.polygon() != polygon || !equals(view.area(), polygon.area()) ||
+                !equals(view.perimeter(), polygon.perimeter()) || mapped.polygon(4).polygon() != rec_ae1) {
+                std::cerr << "Test 20.1 failed. (mapped polygon)\n";
+                return 1;
+            }
+            // numbers go through unchanged
+            Ellipse readEllipse = mapped.ellipse(1);
+            Circle readCircle = mapped.circle(2);
+            if (readEllipse.focuses().first.x != c.x || readEllipse.semiMajorAxis() != ellipse.semiMajorAxis() ||
+                readCircle.radius() != circle.radius()) {
+                std::cerr << "Test 20.2 failed. (mapped ellipse or circle)\n";
+                return 1;
+            }
+        }
+        {
+            std::ofstream bad(path, std::ios::binary);
+            bad << "GEOSxxxxxx";
+        }
+        bool thrown = false;
+        try {
+            MappedShapes mapped(path);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        std::remove(path);
+        if (!thrown) {
+            std::cerr << "Test 20.3 failed. (malformed shape file)\n";
+            return 1;
+        }
+
+        std::stringstream text;
+        {
+            ShapeTextWriter writer(text);
+            for (const Shape *shape : shapes) {
+                writer.write(*shape);
+            }
+        }
+        ShapeTextReader reader(text);
+        for (const Shape *shape : shapes) {
+            if (!reader.next()) {
+                std::cerr << "Test 20.4 failed. (text round trip)\n";
+                return 1;
+            }
+            bool same = reader.kind() == ShapeKind::POLYGON ? reader.polygon() == *shape
+                        : reader.kind() == ShapeKind::ELLIPSE ? reader.ellipse() == *shape
+                        : reader.circle() == *shape;
+            if (!same) {
+                std::cerr << "Test 20.5 failed. (text round trip)\n";
+                return 1;
+            }
+        }
+        if (reader.next() || reader.failed()) {
+            std::cerr << "Test 20.6 failed. (end of text)\n";
+            return 1;
+        }
+
+        // odd spacing is fine; a bad number or a two-vertex polygon stops the reader
+        std::istringstream hand("  POLYGON((0 0,1 0 , 1 1,0 0))\n\tCIRCLE (1.5 -2, 3)ELLIPSE(0 0, 4 0, 6)\n"
+                                "POLYGON ((1 2, x 3))");
+        ShapeTextReader handReader(hand);
+        if (!handReader.next() || handReader.points().size() != 3 ||
+            !handReader.next() || handReader.circle() != Circle(Point(1.5, -2), 3) ||
+            !handReader.next() || handReader.ellipse() != Ellipse(Point(0, 0), Point(4, 0), 6) ||
+            handReader.next() || !handReader.failed()) {
+            std::cerr << "Test 20.7 failed. (hand-written text)\n";
+            return 1;
+        }
+        std::istringstream segment("POLYGON ((0 0, 1 1))");
+        ShapeTextReader segmentReader(segment);
+        if (segmentReader.next() || !segmentReader.failed()) {
+            std::cerr << "Test 20.8 failed. (polygon with two vertices in text)\n";
+            return 1;
+        }
+    }
+
     return 0;
 }
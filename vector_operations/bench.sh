@@ -0,0 +1,7 @@
+#!/bin/bash
+
+set -e
+
+mkdir -p build
+g++ -std=c++17 -O2 -pthread -I./ bench/bench.cpp -o build/vector_ops_bench
+./build/vector_ops_bench "$@"
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "src/batch3d.h"
+#include "src/vec.h"
+#include "src/vector_ops.h"
+
+/**
+ * Benchmarks and differential fuzzing for the task operators. Every row
+ * puts the reference implementation, the scalar std::transform style code
+ * the operators started from, next to what vector_ops.h runs now.
+ *
+ * Usage:
+ *     ./bench.sh [max size]          sizes 3, 10, 100, ... up to max size,
+ *                                    10^8 by default, about 3.7 GB of
+ *                                    memory at that size
+ *     ./bench.sh fuzz [iterations]   compares the operators with the
+ *                                    reference on random inputs, exits with
+ *                                    1 on the first mismatch
+ *
+ * % || and && are measured on n 3D vectors: the reference calls the
+ * std::vector operators once per vector, the task column runs the batched
+ * batch3d.h versions. These rows and stream input keep a heap block per
+ * vector or a text copy of the data, so they stop at MAX_HEAVY_SIZE.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+// element operations timed per benchmark cell, so small sizes are repeated
+#define WORK_PER_CELL 20000000ull
+#define MAX_HEAVY_SIZE 10000000ull
+
+namespace reference {
+
+    template< typename T, typename Op >
+    std::vector<T> zip(const std::vector<T>& lhs, const std::vector<T>& rhs, Op op) {
+        std::vector<T> res;
+        res.reserve(lhs.size());
+        std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), op);
+        return res;
+    }
+
+    template< typename T >
+    std::vector<T> negate(const std::vector<T>& v) {
+        std::vector<T> res;
+        res.reserve(v.size());
+        std::transform(v.begin(), v.end(), std::back_inserter(res), std::negate<T>());
+        return res;
+    }
+
+    template< typename T >
+    T dot(const std::vector<T>& lhs, const std::vector<T>& rhs) {
+        return std::inner_product(lhs.begin(), lhs.end(), rhs.begin(), T());
+    }
+
+    template< typename T >
+    std::vector<T> read(std::istream& stream) {
+        size_t size;
+        stream >> size;
+        std::vector<T> v;
+        std::copy(std::istream_iterator<T>(stream), std::istream_iterator<T>(), std::back_inserter(v));
+        return v;
+    }
+
+}  // namespace reference
+
+// keeps the compiler from dropping a computation whose result is unused
+template< typename R >
+inline void consume(const R& result) {
+    asm volatile("" : : "g"(&result) : "memory");
+}
+
+template< typename T >
+std::vector<T> randomVector(std::mt19937& rand, size_t n) {
+    std::vector<T> v(n);
+    if constexpr (std::is_integral<T>::value) {
+        std::uniform_int_distribution<T> values(-300, 300);
+        for (auto& x : v) {
+            x = values(rand);
+        }
+    } else {
+        std::uniform_real_distribution<T> values(-1000.0, 1000.0);
+        for (auto& x : v) {
+            x = values(rand);
+        }
+    }
+    return v;
+}
+
+template< typename T >
+const char* typeName() {
+    return std::is_integral<T>::value ? "int" : "double";
+}
+
+/* ------------------------------ benchmarks ------------------------------ */
+
+template< typename Body >
+double nanosPerElement(size_t n, Body body) {
+    const size_t reps = std::max<size_t>(1, WORK_PER_CELL / n);
+    body();
+    auto start = Clock::now();
+    for (size_t rep = 0; rep < reps; ++rep) {
+        body();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (reps * n);
+}
+
+template< typename Reference, typename Task >
+void row(const std::string& op, const char* type, size_t n, Reference reference, Task task) {
+    double referenceNanos = nanosPerElement(n, reference);
+    double taskNanos = nanosPerElement(n, task);
+    std::cout << std::left << std::setw(16) << op << std::setw(8) << type << std::right
+              << std::setw(12) << n << std::fixed << std::setprecision(3)
+              << std::setw(14) << referenceNanos << std::setw(14) << taskNanos
+              << std::setprecision(2) << std::setw(10) << referenceNanos / taskNanos << std::endl;
+}
+
+template< typename T >
+void benchSize(size_t n) {
+    using namespace task;
+    std::mt19937 rand(42);
+    const std::vector<T> a = randomVector<T>(rand, n);
+    const std::vector<T> b = randomVector<T>(rand, n);
+    std::vector<T> out;
+    const char* type = typeName<T>();
+
+    row("a + b", type, n, [&] { consume(reference::zip(a, b, std::plus<T>())); },
+        [&] { consume(a + b); });
+    row("a - b", type, n, [&] { consume(reference::zip(a, b, std::minus<T>())); },
+        [&] { consume(a - b); });
+    row("-a", type, n, [&] { consume(reference::negate(a)); },
+        [&] { consume(-a); });
+    row("a * b", type, n, [&] { consume(reference::dot(a, b)); },
+        [&] { consume(a * b); });
+    {
+        // freed before the lazy row, whose reference holds two temporaries
+        std::vector<T> acc = a;
+        row("acc += b", type, n, [&] {
+                for (size_t i = 0; i < n; ++i) {
+                    acc[i] += b[i];
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    acc[i] -= b[i];
+                }
+                consume(acc);
+            }, [&] {
+                acc += b;
+                acc -= b;
+                consume(acc);
+            });
+    }
+    row("a + b - a lazy", type, n, [&] {
+            consume(reference::zip(reference::zip(a, b, std::plus<T>()), a, std::minus<T>()));
+        }, [&] {
+            expr::evaluate(expr::lazy(a) + b - a, out);
+            consume(out);
+        });
+    if constexpr (std::is_integral<T>::value) {
+        row("a | b", type, n, [&] { consume(reference::zip(a, b, std::bit_or<T>())); },
+            [&] { consume(a | b); });
+        row("a & b", type, n, [&] { consume(reference::zip(a, b, std::bit_and<T>())); },
+            [&] { consume(a & b); });
+    }
+
+    if(n > MAX_HEAVY_SIZE) {
+        return;
+    }
+
+    // n 3D vectors: per-vector std::vector operators against the SoA batch
+    std::vector<std::vector<T>> lhs3(n), rhs3(n);
+    Vectors3<T> lhsBatch, rhsBatch, crossBatch;
+    std::vector<uint8_t> mask;
+    for (size_t i = 0; i < n; ++i) {
+        lhs3[i] = {a[i], b[i], a[n - 1 - i]};
+        rhs3[i] = {b[i], a[i], b[n - 1 - i]};
+        lhsBatch.push_back(lhs3[i]);
+        rhsBatch.push_back(rhs3[i]);
+    }
+    row("a % b (3D)", type, n, [&] {
+            for (size_t i = 0; i < n; ++i) {
+                consume(lhs3[i] % rhs3[i]);
+            }
+        }, [&] {
+            cross(lhsBatch, rhsBatch, crossBatch);
+            consume(crossBatch);
+        });
+    row("a || b (3D)", type, n, [&] {
+            for (size_t i = 0; i < n; ++i) {
+                consume(lhs3[i] || rhs3[i]);
+            }
+        }, [&] {
+            collinear(lhsBatch, rhsBatch, mask);
+            consume(mask);
+        });
+    row("a && b (3D)", type, n, [&] {
+            for (size_t i = 0; i < n; ++i) {
+                consume(lhs3[i] && rhs3[i]);
+            }
+        }, [&] {
+            codirected(lhsBatch, rhsBatch, mask);
+            consume(mask);
+        });
+
+    std::stringstream text;
+    text << n << '\n' << a;
+    const std::string input = text.str();
+    row(">> a", type, n, [&] {
+            std::istringstream stream(input);
+            consume(reference::read<T>(stream));
+        }, [&] {
+            std::istringstream stream(input);
+            stream >> out;
+            consume(out);
+        });
+}
+
+int bench(size_t maxSize) {
+    std::cout << std::left << std::setw(16) << "operator" << std::setw(8) << "type" << std::right
+              << std::setw(12) << "size" << std::setw(14) << "ref ns/elem" << std::setw(14)
+              << "task ns/elem" << std::setw(10) << "speedup" << std::endl;
+    std::vector<size_t> sizes = {3};
+    for (size_t n = 10; n <= maxSize; n *= 10) {
+        sizes.push_back(n);
+    }
+    for (size_t n : sizes) {
+        benchSize<int>(n);
+        benchSize<double>(n);
+    }
+    return 0;
+}
+
+/* -------------------------------- fuzzing ------------------------------- */
+
+struct Mismatch {
+    std::string what;
+};
+
+void expect(bool ok, const std::string& op, const char* type, size_t n) {
+    if(!ok) {
+        std::ostringstream what;
+        what << op << " on " << type << " vectors of size " << n << " differs from the reference";
+        throw Mismatch{what.str()};
+    }
+}
+
+// floating point reductions may add in any order: allow the usual bound
+template< typename T >
+bool closeSums(T value, T expected, T magnitude, size_t n) {
+    if constexpr (std::is_integral<T>::value) {
+        return value == expected;
+    } else {
+        return std::fabs(value - expected) <= 4 * (n + 1) * std::numeric_limits<T>::epsilon() * magnitude;
+    }
+}
+
+template< typename T >
+void fuzzOnce(std::mt19937& rand, size_t n) {
+    using namespace task;
+    const char* type = typeName<T>();
+    const std::vector<T> a = randomVector<T>(rand, n);
+    const std::vector<T> b = randomVector<T>(rand, n);
+    std::vector<T> out;
+
+    expect(a + b == reference::zip(a, b, std::plus<T>()), "a + b", type, n);
+    expect(a - b == reference::zip(a, b, std::minus<T>()), "a - b", type, n);
+    expect(-a == reference::negate(a), "-a", type, n);
+
+    T magnitude = T();
+    for (size_t i = 0; i < n; ++i) {
+        magnitude += a[i] * b[i] < 0 ? -(a[i] * b[i]) : a[i] * b[i];
+    }
+    expect(closeSums(a * b, reference::dot(a, b), magnitude, n), "a * b", type, n);
+    if constexpr (std::is_floating_point<T>::value) {
+        expect(closeSums(dot(a, b, Summation::COMPENSATED), reference::dot(a, b), magnitude, n),
+               "compensated dot", type, n);
+    }
+    if(n > 0) {
+        expect(min(a) == *std::min_element(a.begin(), a.end()), "min", type, n);
+        expect(max(a) == *std::max_element(a.begin(), a.end()), "max", type, n);
+    }
+
+    std::vector<T> acc = a;
+    acc += b;
+    expect(acc == reference::zip(a, b, std::plus<T>()), "+=", type, n);
+    acc = a;
+    acc -= b;
+    expect(acc == reference::zip(a, b, std::minus<T>()), "-=", type, n);
+    acc = a;
+    acc *= 3;
+    expect(acc == reference::zip(a, a, [] (T x, T) { return 3 * x; }), "*=", type, n);
+
+    add(a, b, out);
+    expect(out == reference::zip(a, b, std::plus<T>()), "add", type, n);
+    subtract(a, b, out);
+    expect(out == reference::zip(a, b, std::minus<T>()), "subtract", type, n);
+    expr::evaluate(expr::lazy(a) + b - a, out);
+    expect(out == reference::zip(reference::zip(a, b, std::plus<T>()), a, std::minus<T>()),
+           "lazy a + b - a", type, n);
+
+    if constexpr (std::is_integral<T>::value) {
+        expect((a | b) == reference::zip(a, b, std::bit_or<T>()), "a | b", type, n);
+        expect((a & b) == reference::zip(a, b, std::bit_and<T>()), "a & b", type, n);
+        acc = a;
+        acc |= b;
+        expect(acc == reference::zip(a, b, std::bit_or<T>()), "|=", type, n);
+    }
+
+    std::stringstream text;
+    text << n << '\n' << a << "tail";
+    const std::string input = text.str();
+    std::istringstream fast(input), slow(input);
+    fast >> out;
+    std::vector<T> expected = reference::read<T>(slow);
+    expect(out == expected, ">>", type, n);
+    std::string tail;
+    fast >> tail;
+    expect(tail == "tail", ">> leaves the rest of the stream", type, n);
+
+    // 3D operators: every third pair is made collinear on purpose
+    Vectors3<T> lhs, rhs, crossed;
+    for (size_t i = 0; i + 2 < n; i += 3) {
+        T k = i % 2 ? 2 : -3;
+        std::vector<T> u = {a[i], a[i + 1], a[i + 2]};
+        std::vector<T> v = i % 9 == 0 ? std::vector<T>{k * u[0], k * u[1], k * u[2]}
+                                      : std::vector<T>{b[i], b[i + 1], b[i + 2]};
+        lhs.push_back(u);
+        rhs.push_back(v);
+    }
+    std::vector<uint8_t> parallel, sameDirection;
+    cross(lhs, rhs, crossed);
+    collinear(lhs, rhs, parallel);
+    codirected(lhs, rhs, sameDirection);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        Vec<T, 3> u(lhs.at(i)), v(rhs.at(i));
+        expect(crossed.at(i) == lhs.at(i) % rhs.at(i), "batched %", type, n);
+        expect(static_cast<std::vector<T>>(u % v) == lhs.at(i) % rhs.at(i), "Vec %", type, n);
+        expect(parallel[i] == (u || v), "batched ||", type, n);
+        expect(sameDirection[i] == (u && v), "batched &&", type, n);
+    }
+}
+
+// sizes around SIMD widths and unrolled block lengths are the interesting ones
+size_t fuzzSize(std::mt19937& rand) {
+    switch (rand() % 3) {
+        case 0:
+            return rand() % 20;
+        case 1:
+            return 32 * (1 + rand() % 8) + rand() % 3 - 1;
+        default:
+            return rand() % 5000;
+    }
+}
+
+int fuzz(size_t iterations) {
+    std::mt19937 rand(20201006);
+    try {
+        for (size_t i = 0; i < iterations; ++i) {
+            size_t n = fuzzSize(rand);
+            fuzzOnce<int>(rand, n);
+            fuzzOnce<double>(rand, n);
+        }
+    } catch (const Mismatch& mismatch) {
+        std::cout << "FAILED: " << mismatch.what << std::endl;
+        return 1;
+    }
+    std::cout << iterations << " iterations, no mismatches" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1 && std::string(argv[1]) == "fuzz") {
+        return fuzz(argc > 2 ? std::stoul(argv[2]) : 1000);
+    }
+    return bench(argc > 1 ? std::stoull(argv[1]) : 100000000);
+}
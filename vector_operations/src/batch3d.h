@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "simd.h"
+#include "vector_ops.h"
+
+namespace task {
+
+    /**
+     * Many 3D vectors in structure-of-arrays layout: x[i], y[i], z[i] is the
+     * i-th vector. Batched operations below run over whole arrays with SIMD
+     * packs and write into caller-owned outputs, which are only reallocated
+     * when their capacity is too small.
+     */
+    template< typename T >
+    struct Vectors3 {
+        std::vector<T> x;
+        std::vector<T> y;
+        std::vector<T> z;
+
+        size_t size() const {
+            return x.size();
+        }
+
+        void resize(size_t n) {
+            x.resize(n);
+            y.resize(n);
+            z.resize(n);
+        }
+
+        void reserve(size_t n) {
+            x.reserve(n);
+            y.reserve(n);
+            z.reserve(n);
+        }
+
+        void push_back(const T& vx, const T& vy, const T& vz) {
+            x.push_back(vx);
+            y.push_back(vy);
+            z.push_back(vz);
+        }
+
+        void push_back(const std::vector<T>& v) {
+            if(v.size() != 3) {
+                throw std::runtime_error("Vector product available only for 3D vectors!");
+            }
+            push_back(v[0], v[1], v[2]);
+        }
+
+        std::vector<T> at(size_t i) const {
+            return std::vector<T> {x[i], y[i], z[i]};
+        }
+    };
+
+    namespace detail {
+
+        template< typename T >
+        void checkSizes(const Vectors3<T>& lhs, const Vectors3<T>& rhs) {
+            if(lhs.size() != rhs.size()
+               || lhs.y.size() != lhs.size() || lhs.z.size() != lhs.size()
+               || rhs.y.size() != rhs.size() || rhs.z.size() != rhs.size()) {
+                throw std::runtime_error("Vectors should be of same size!");
+            }
+        }
+
+        /**
+         * Calls kernel(ax, ay, az, bx, by, bz, i) first with SIMD packs, then
+         * with scalars for the tail. The kernel stores its own results.
+         */
+        template< typename T, typename Kernel >
+        void forEach3(const Vectors3<T>& lhs, const Vectors3<T>& rhs, Kernel kernel) {
+            const size_t n = lhs.size();
+            size_t i = 0;
+            if constexpr (simd::supported<T>) {
+                for (; i + simd::width<T> <= n; i += simd::width<T>) {
+                    kernel(simd::load(&lhs.x[i]), simd::load(&lhs.y[i]), simd::load(&lhs.z[i]),
+                           simd::load(&rhs.x[i]), simd::load(&rhs.y[i]), simd::load(&rhs.z[i]), i);
+                }
+            }
+            for (; i < n; ++i) {
+                kernel(lhs.x[i], lhs.y[i], lhs.z[i], rhs.x[i], rhs.y[i], rhs.z[i], i);
+            }
+        }
+
+        template< typename T, typename Mask >
+        void storeMask(uint8_t* out, const Mask& mask) {
+            if constexpr (std::is_arithmetic<Mask>::value) {
+                *out = mask != 0;
+            } else {
+                for (size_t lane = 0; lane < simd::width<T>; ++lane) {
+                    out[lane] = mask[lane] != 0;
+                }
+            }
+        }
+
+        /**
+         * Integer lanes are multiplied as unsigned, at least unsigned int,
+         * so products that overflow T wrap modulo 2^bits instead of being
+         * undefined. Floating point lanes pass through unchanged.
+         */
+        template< typename T >
+        using Wrapping = std::conditional_t<std::is_integral<T>::value,
+                std::common_type_t<std::make_unsigned_t<std::conditional_t<std::is_integral<T>::value, T, int>>, unsigned>,
+                T>;
+
+        template< typename T, typename V >
+        auto toWrapping(const V& v) {
+            if constexpr (std::is_arithmetic<V>::value) {
+                return static_cast<Wrapping<T>>(v);
+            } else if constexpr (std::is_integral<T>::value) {
+                return (simd::Pack<Wrapping<T>>) v;
+            } else {
+                return v;
+            }
+        }
+
+        // products of two T values fit this type exactly
+        template< typename T >
+        struct WideProduct {
+            typedef std::conditional_t<std::is_signed<T>::value, int64_t, uint64_t> type;
+        };
+
+        template<>
+        struct WideProduct<long long> {
+            __extension__ typedef __int128 type;
+        };
+
+        template<>
+        struct WideProduct<unsigned long long> {
+            __extension__ typedef unsigned __int128 type;
+        };
+
+        template<>
+        struct WideProduct<long> {
+            __extension__ typedef std::conditional_t<sizeof(long) == 8, __int128, int64_t> type;
+        };
+
+        template<>
+        struct WideProduct<unsigned long> {
+            __extension__ typedef std::conditional_t<sizeof(long) == 8, unsigned __int128, uint64_t> type;
+        };
+
+        /**
+         * Exact integer test on widened scalars. a x b == 0 is checked as
+         * equality of the paired products, so nothing is subtracted. For
+         * parallel vectors the terms of a . b share one sign, so a . b >= 0
+         * exactly when no term is negative and the sum is never formed.
+         */
+        template< typename T >
+        bool integerCollinear(T ax, T ay, T az, T bx, T by, T bz, bool sameDirection) {
+            typedef typename WideProduct<T>::type W;
+            bool parallel = W(ay) * bz == W(az) * by
+                    && W(az) * bx == W(ax) * bz
+                    && W(ax) * by == W(ay) * bx;
+            return parallel && (!sameDirection
+                    || (W(ax) * bx >= 0 && W(ay) * by >= 0 && W(az) * bz >= 0));
+        }
+
+        /**
+         * Division-free collinearity: |a x b|^2 <= eps^2 |a|^2 |b|^2, i.e. the
+         * sine of the angle between a and b is at most eps. Integer vectors
+         * are compared exactly, a x b == 0, one scalar at a time: their cross
+         * and dot products need twice the bits of T. A zero vector is
+         * collinear with anything.
+         */
+        template< typename T >
+        void testCollinear(const Vectors3<T>& lhs, const Vectors3<T>& rhs, std::vector<uint8_t>& out,
+                           double eps, bool sameDirection) {
+            checkSizes(lhs, rhs);
+            out.resize(lhs.size());
+            if constexpr (std::is_integral<T>::value) {
+                for (size_t i = 0; i < lhs.size(); ++i) {
+                    out[i] = integerCollinear(lhs.x[i], lhs.y[i], lhs.z[i], rhs.x[i], rhs.y[i], rhs.z[i],
+                                              sameDirection);
+                }
+            } else {
+                const T eps2 = static_cast<T>(eps * eps);
+                uint8_t* res = out.data();
+                forEach3(lhs, rhs, [=] (auto ax, auto ay, auto az, auto bx, auto by, auto bz, size_t i) {
+                    auto cx = ay * bz - az * by;
+                    auto cy = az * bx - ax * bz;
+                    auto cz = ax * by - ay * bx;
+                    auto cross2 = cx * cx + cy * cy + cz * cz;
+                    auto parallel = cross2 <= eps2 * (ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz);
+                    auto dot = ax * bx + ay * by + az * bz;
+                    auto mask = sameDirection ? (parallel & (dot >= 0)) : parallel;
+                    storeMask<T>(res + i, mask);
+                });
+            }
+        }
+
+    }  // namespace detail
+
+    // out[i] = lhs[i] % rhs[i]; integer components that do not fit T wrap around
+    template< typename T >
+    void cross(const Vectors3<T>& lhs, const Vectors3<T>& rhs, Vectors3<T>& out) {
+        detail::checkSizes(lhs, rhs);
+        out.resize(lhs.size());
+        T* ox = out.x.data();
+        T* oy = out.y.data();
+        T* oz = out.z.data();
+        detail::forEach3(lhs, rhs, [=] (auto ax, auto ay, auto az, auto bx, auto by, auto bz, size_t i) {
+            auto cx = detail::toWrapping<T>(ay) * detail::toWrapping<T>(bz)
+                    - detail::toWrapping<T>(az) * detail::toWrapping<T>(by);
+            auto cy = detail::toWrapping<T>(az) * detail::toWrapping<T>(bx)
+                    - detail::toWrapping<T>(ax) * detail::toWrapping<T>(bz);
+            auto cz = detail::toWrapping<T>(ax) * detail::toWrapping<T>(by)
+                    - detail::toWrapping<T>(ay) * detail::toWrapping<T>(bx);
+            if constexpr (std::is_arithmetic<decltype(cx)>::value) {
+                ox[i] = static_cast<T>(cx);
+                oy[i] = static_cast<T>(cy);
+                oz[i] = static_cast<T>(cz);
+            } else {
+                simd::store(ox + i, (simd::Pack<T>) cx);
+                simd::store(oy + i, (simd::Pack<T>) cy);
+                simd::store(oz + i, (simd::Pack<T>) cz);
+            }
+        });
+    }
+
+    // out[i] = lhs[i] || rhs[i], with sine tolerance eps
+    template< typename T >
+    void collinear(const Vectors3<T>& lhs, const Vectors3<T>& rhs, std::vector<uint8_t>& out,
+                   double eps = EPSILON) {
+        detail::testCollinear(lhs, rhs, out, eps, false);
+    }
+
+    // out[i] = lhs[i] && rhs[i]: collinear and not pointing in opposite directions
+    template< typename T >
+    void codirected(const Vectors3<T>& lhs, const Vectors3<T>& rhs, std::vector<uint8_t>& out,
+                    double eps = EPSILON) {
+        detail::testCollinear(lhs, rhs, out, eps, true);
+    }
+
+}  // namespace task
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "simd.h"
+
+namespace task {
+namespace expr {
+
+    /**
+     * Lazy element-wise expressions over std::vector. Wrapping an operand
+     * with lazy() switches + - | & and unary - to building an expression
+     * tree; nothing is computed until it is evaluated into a destination, in
+     * one pass and without temporaries:
+     *
+     *     evaluate(lazy(a) + b - c, dst);
+     *     std::vector<double> res = -(lazy(a) + b);
+     *
+     * Expressions keep references to their operands, so they must be
+     * evaluated before any operand goes away or changes size. The
+     * destination may be one of the operands.
+     */
+    template< typename E >
+    struct Expression {
+        const E& self() const {
+            return static_cast<const E&>(*this);
+        }
+
+        template< typename T >
+        operator std::vector<T>() const {
+            std::vector<T> res;
+            evaluate(self(), res);
+            return res;
+        }
+    };
+
+    template< typename T >
+    class Ref : public Expression<Ref<T>> {
+    private:
+        const std::vector<T>& v;
+
+    public:
+        using value_type = T;
+
+        explicit Ref(const std::vector<T>& v) : v(v) {}
+
+        size_t size() const {
+            return v.size();
+        }
+
+        T operator [] (size_t i) const {
+            return v[i];
+        }
+
+        simd::Pack<T> pack(size_t i) const {
+            return simd::load(v.data() + i);
+        }
+    };
+
+    template< typename L, typename R, typename Op >
+    class Binary : public Expression<Binary<L, R, Op>> {
+    private:
+        L lhs;
+        R rhs;
+        Op op;
+
+    public:
+        using value_type = typename L::value_type;
+
+        Binary(const L& lhs, const R& rhs, Op op) : lhs(lhs), rhs(rhs), op(op) {
+            if(lhs.size() != rhs.size()) {
+                throw std::runtime_error("Vectors should be of same size!");
+            }
+        }
+
+        size_t size() const {
+            return lhs.size();
+        }
+
+        value_type operator [] (size_t i) const {
+            return op(lhs[i], rhs[i]);
+        }
+
+        simd::Pack<value_type> pack(size_t i) const {
+            return op(lhs.pack(i), rhs.pack(i));
+        }
+    };
+
+    template< typename E, typename Op >
+    class Unary : public Expression<Unary<E, Op>> {
+    private:
+        E operand;
+        Op op;
+
+    public:
+        using value_type = typename E::value_type;
+
+        Unary(const E& operand, Op op) : operand(operand), op(op) {}
+
+        size_t size() const {
+            return operand.size();
+        }
+
+        value_type operator [] (size_t i) const {
+            return op(operand[i]);
+        }
+
+        simd::Pack<value_type> pack(size_t i) const {
+            return op(operand.pack(i));
+        }
+    };
+
+    template< typename T >
+    Ref<T> lazy(const std::vector<T>& v) {
+        return Ref<T>(v);
+    }
+
+    // an expression over a temporary would dangle
+    template< typename T >
+    Ref<T> lazy(std::vector<T>&& v) = delete;
+
+    /**
+     * Writes the expression into dst. dst is only reallocated when its
+     * capacity is smaller than the expression size.
+     */
+    template< typename E, typename T >
+    void evaluate(const Expression<E>& expression, std::vector<T>& dst) {
+        const E& e = expression.self();
+        const size_t n = e.size();
+        dst.resize(n);
+        T* out = dst.data();
+        size_t i = 0;
+        if constexpr (simd::supported<T>) {
+            for (; i + simd::width<T> <= n; i += simd::width<T>) {
+                simd::store(out + i, e.pack(i));
+            }
+        }
+        for (; i < n; ++i) {
+            out[i] = e[i];
+        }
+    }
+
+    namespace detail {
+
+        template< typename E >
+        const E& operand(const Expression<E>& e) {
+            return e.self();
+        }
+
+        template< typename T >
+        Ref<T> operand(const std::vector<T>& v) {
+            return Ref<T>(v);
+        }
+
+        template< typename T >
+        struct IsExpression : std::is_base_of<Expression<T>, T> {};
+
+        // at least one side has to be an expression, so plain vectors keep
+        // the eager task:: operators
+        template< typename L, typename R >
+        using EnableLazy = std::enable_if_t<IsExpression<L>::value || IsExpression<R>::value>;
+
+        constexpr auto plus = [] (auto lhs, auto rhs) { return lhs + rhs; };
+        constexpr auto minus = [] (auto lhs, auto rhs) { return lhs - rhs; };
+        constexpr auto bitOr = [] (auto lhs, auto rhs) { return lhs | rhs; };
+        constexpr auto bitAnd = [] (auto lhs, auto rhs) { return lhs & rhs; };
+        constexpr auto negate = [] (auto x) { return -x; };
+
+        template< typename L, typename R, typename Op >
+        auto combine(const L& lhs, const R& rhs, Op op) {
+            auto l = operand(lhs);
+            auto r = operand(rhs);
+            return Binary<decltype(l), decltype(r), Op>(l, r, op);
+        }
+
+    }  // namespace detail
+
+    template< typename L, typename R, typename = detail::EnableLazy<L, R> >
+    auto operator + (const L& lhs, const R& rhs) {
+        return detail::combine(lhs, rhs, detail::plus);
+    }
+
+    template< typename L, typename R, typename = detail::EnableLazy<L, R> >
+    auto operator - (const L& lhs, const R& rhs) {
+        return detail::combine(lhs, rhs, detail::minus);
+    }
+
+    template< typename L, typename R, typename = detail::EnableLazy<L, R> >
+    auto operator | (const L& lhs, const R& rhs) {
+        auto res = detail::combine(lhs, rhs, detail::bitOr);
+        using T = typename decltype(res)::value_type;
+        static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                      "Bitwise or can be done only with integers!");
+        return res;
+    }
+
+    template< typename L, typename R, typename = detail::EnableLazy<L, R> >
+    auto operator & (const L& lhs, const R& rhs) {
+        auto res = detail::combine(lhs, rhs, detail::bitAnd);
+        using T = typename decltype(res)::value_type;
+        static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                      "Bitwise and can be done only with integers!");
+        return res;
+    }
+
+    template< typename E >
+    auto operator - (const Expression<E>& e) {
+        return Unary<E, decltype(detail::negate)>(e.self(), detail::negate);
+    }
+
+    template< typename E >
+    const E& operator + (const Expression<E>& e) {
+        return e.self();
+    }
+
+}  // namespace expr
+}  // namespace task
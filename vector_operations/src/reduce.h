@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "simd.h"
+
+// vectors shorter than this are reduced on the calling thread
+#define PARALLEL_THRESHOLD (1u << 18)
+
+namespace task {
+
+    /**
+     * Fixed set of worker threads, started on first use. run() splits work
+     * into parts, executes part 0 on the calling thread and waits for the
+     * rest. Calls from different threads are serialized.
+     */
+    class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex callMutex;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        const std::function<void(size_t)>* job = nullptr;
+        size_t parts = 0;
+        size_t nextPart = 0;
+        size_t pending = 0;
+        size_t generation = 0;
+        bool stopping = false;
+
+        void work() {
+            size_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                while (nextPart < parts) {
+                    size_t part = nextPart++;
+                    lock.unlock();
+                    (*job)(part);
+                    lock.lock();
+                    if (--pending == 0) {
+                        finished.notify_one();
+                    }
+                }
+            }
+        }
+
+        ThreadPool() {
+            size_t count = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t i = 1; i < count; ++i) {
+                workers.emplace_back(&ThreadPool::work, this);
+            }
+        }
+
+    public:
+        ThreadPool(const ThreadPool& copy) = delete;
+
+        ThreadPool& operator = (const ThreadPool& other) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        static ThreadPool& instance() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        size_t concurrency() const {
+            return workers.size() + 1;
+        }
+
+        void run(size_t count, const std::function<void(size_t)>& body) {
+            if (count <= 1 || workers.empty()) {
+                for (size_t part = 0; part < count; ++part) {
+                    body(part);
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> call(callMutex);
+            std::unique_lock<std::mutex> lock(mutex);
+            job = &body;
+            parts = count;
+            nextPart = 1;
+            pending = count - 1;
+            ++generation;
+            lock.unlock();
+            wake.notify_all();
+
+            body(0);
+
+            lock.lock();
+            // the caller helps with whatever the workers have not picked up
+            while (nextPart < parts) {
+                size_t part = nextPart++;
+                lock.unlock();
+                body(part);
+                lock.lock();
+                --pending;
+            }
+            finished.wait(lock, [&] { return pending == 0; });
+            job = nullptr;
+        }
+    };
+
+    enum class Summation {
+        FAST,          // SIMD accumulators, order of additions is unspecified
+        COMPENSATED    // error-free transformations, nearly correctly rounded
+    };
+
+    namespace detail {
+
+        // Neumaier's variant of Kahan summation: value + error
+        template< typename T >
+        struct Compensated {
+            T value = T();
+            T error = T();
+
+            void add(T x) {
+                T t = value + x;
+                if (std::fabs(value) >= std::fabs(x)) {
+                    error += (value - t) + x;
+                } else {
+                    error += (x - t) + value;
+                }
+                value = t;
+            }
+
+            // product is added exactly: its rounding error comes from fma
+            void addProduct(T a, T b) {
+                T p = a * b;
+                add(p);
+                error += std::fma(a, b, -p);
+            }
+
+            void add(const Compensated& other) {
+                add(other.value);
+                error += other.error;
+            }
+
+            T result() const {
+                return value + error;
+            }
+        };
+
+        /**
+         * Splits [0, n) into per-thread ranges when n is large enough,
+         * reduces every range with partial(begin, end) and folds the
+         * partial results with merge in range order.
+         */
+        template< typename R, typename Partial, typename Merge >
+        R parallelReduce(size_t n, Partial partial, Merge merge) {
+            // short inputs never touch the pool, so they never start it
+            if (n < PARALLEL_THRESHOLD) {
+                return partial(0, n);
+            }
+            ThreadPool& pool = ThreadPool::instance();
+            if (pool.concurrency() == 1) {
+                return partial(0, n);
+            }
+            const size_t step = (n + pool.concurrency() - 1) / pool.concurrency();
+            const size_t parts = (n + step - 1) / step;
+            std::vector<R> results(parts);
+            std::function<void(size_t)> body = [&] (size_t part) {
+                size_t begin = std::min(n, part * step);
+                results[part] = partial(begin, std::min(n, begin + step));
+            };
+            pool.run(parts, body);
+            R res = results[0];
+            for (size_t part = 1; part < parts; ++part) {
+                res = merge(res, results[part]);
+            }
+            return res;
+        }
+
+        template< typename T >
+        void checkNotEmpty(const std::vector<T>& v) {
+            if(v.empty()) {
+                throw std::runtime_error("Vector should not be empty!");
+            }
+        }
+
+    }  // namespace detail
+
+    template< typename T >
+    T dot(const std::vector<T>& lhs, const std::vector<T>& rhs, Summation mode = Summation::FAST) {
+        if(lhs.size() != rhs.size()) {
+            throw std::runtime_error("Vectors should be of same size!");
+        }
+        const T* l = lhs.data();
+        const T* r = rhs.data();
+        if constexpr (std::is_floating_point<T>::value) {
+            if (mode == Summation::COMPENSATED) {
+                using Acc = detail::Compensated<T>;
+                return detail::parallelReduce<Acc>(lhs.size(), [l, r] (size_t begin, size_t end) {
+                    Acc acc;
+                    for (size_t i = begin; i < end; ++i) {
+                        acc.addProduct(l[i], r[i]);
+                    }
+                    return acc;
+                }, [] (Acc a, const Acc& b) { a.add(b); return a; }).result();
+            }
+        }
+        return detail::parallelReduce<T>(lhs.size(), [l, r] (size_t begin, size_t end) {
+            if constexpr (simd::supported<T>) {
+                return simd::dot(l + begin, r + begin, end - begin);
+            } else {
+                return std::inner_product(l + begin, l + end, r + begin, T());
+            }
+        }, std::plus<T>());
+    }
+
+    template< typename T >
+    T sum(const std::vector<T>& v, Summation mode = Summation::FAST) {
+        const T* src = v.data();
+        if constexpr (std::is_floating_point<T>::value) {
+            if (mode == Summation::COMPENSATED) {
+                using Acc = detail::Compensated<T>;
+                return detail::parallelReduce<Acc>(v.size(), [src] (size_t begin, size_t end) {
+                    Acc acc;
+                    for (size_t i = begin; i < end; ++i) {
+                        acc.add(src[i]);
+                    }
+                    return acc;
+                }, [] (Acc a, const Acc& b) { a.add(b); return a; }).result();
+            }
+        }
+        return detail::parallelReduce<T>(v.size(), [src] (size_t begin, size_t end) {
+            if constexpr (simd::supported<T>) {
+                return simd::reduce(src + begin, end - begin, [] (auto x) { return x; });
+            } else {
+                return std::accumulate(src + begin, src + end, T());
+            }
+        }, std::plus<T>());
+    }
+
+    // Euclidean norm
+    template< typename T >
+    auto norm(const std::vector<T>& v, Summation mode = Summation::FAST) {
+        return std::sqrt(dot(v, v, mode));
+    }
+
+    template< typename T >
+    T min(const std::vector<T>& v) {
+        detail::checkNotEmpty(v);
+        const T* src = v.data();
+        auto op = [] (auto a, auto b) { return b < a ? b : a; };
+        return detail::parallelReduce<T>(v.size(), [src, op] (size_t begin, size_t end) {
+            if constexpr (simd::supported<T>) {
+                return simd::fold(src + begin, end - begin, op);
+            } else {
+                return *std::min_element(src + begin, src + end);
+            }
+        }, op);
+    }
+
+    template< typename T >
+    T max(const std::vector<T>& v) {
+        detail::checkNotEmpty(v);
+        const T* src = v.data();
+        auto op = [] (auto a, auto b) { return a < b ? b : a; };
+        return detail::parallelReduce<T>(v.size(), [src, op] (size_t begin, size_t end) {
+            if constexpr (simd::supported<T>) {
+                return simd::fold(src + begin, end - begin, op);
+            } else {
+                return *std::max_element(src + begin, src + end);
+            }
+        }, op);
+    }
+
+}  // namespace task
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __AVX__
+#define SIMD_BYTES 32
+#else
+#define SIMD_BYTES 16
+#endif
+
+namespace task {
+namespace simd {
+
+    // element types that have explicit SIMD kernels: float, double and 32 or
+    // 64 bit integers, signed or not
+    template< typename T >
+    constexpr bool supported = std::is_same<T, float>::value
+            || std::is_same<T, double>::value
+            || (std::is_integral<T>::value && !std::is_same<T, bool>::value
+                && (sizeof(T) == 4 || sizeof(T) == 8));
+
+    template< typename T >
+    struct Register {
+        // GCC vector extension: arithmetic and bitwise operators work lane-wise
+        typedef T type __attribute__((vector_size(SIMD_BYTES)));
+    };
+
+    template< typename T >
+    using Pack = typename Register<T>::type;
+
+    template< typename T >
+    constexpr size_t width = SIMD_BYTES / sizeof(T);
+
+    template< typename T >
+    inline Pack<T> load(const T* src) {
+        Pack<T> pack;
+        std::memcpy(&pack, src, sizeof(pack));
+        return pack;
+    }
+
+    template< typename T >
+    inline void store(T* dst, const Pack<T>& pack) {
+        std::memcpy(dst, &pack, sizeof(pack));
+    }
+
+    template< typename T >
+    inline T sum(const Pack<T>& pack) {
+        T res = T();
+        for (size_t i = 0; i < width<T>; ++i) {
+            res += pack[i];
+        }
+        return res;
+    }
+
+    /**
+     * out[i] = op(lhs[i], rhs[i]). Op must accept both scalars and packs,
+     * e.g. a generic lambda. out may alias lhs or rhs.
+     */
+    template< typename T, typename Op >
+    void binary(const T* lhs, const T* rhs, T* out, size_t n, Op op) {
+        const size_t w = width<T>;
+        size_t i = 0;
+        for (; i + 2 * w <= n; i += 2 * w) {
+            Pack<T> first = op(load(lhs + i), load(rhs + i));
+            Pack<T> second = op(load(lhs + i + w), load(rhs + i + w));
+            store(out + i, first);
+            store(out + i + w, second);
+        }
+        for (; i < n; ++i) {
+            out[i] = op(lhs[i], rhs[i]);
+        }
+    }
+
+    template< typename T, typename Op >
+    void unary(const T* src, T* out, size_t n, Op op) {
+        const size_t w = width<T>;
+        size_t i = 0;
+        for (; i + w <= n; i += w) {
+            store(out + i, op(load(src + i)));
+        }
+        for (; i < n; ++i) {
+            out[i] = op(src[i]);
+        }
+    }
+
+    /**
+     * sum of map(lhs[i], rhs[i]) with four independent accumulators, so that
+     * the additions are not serialized on one register
+     */
+    template< typename T, typename Map >
+    T reduce(const T* lhs, const T* rhs, size_t n, Map map) {
+        const size_t w = width<T>;
+        Pack<T> acc0 = {}, acc1 = {}, acc2 = {}, acc3 = {};
+        size_t i = 0;
+        for (; i + 4 * w <= n; i += 4 * w) {
+            acc0 += map(load(lhs + i), load(rhs + i));
+            acc1 += map(load(lhs + i + w), load(rhs + i + w));
+            acc2 += map(load(lhs + i + 2 * w), load(rhs + i + 2 * w));
+            acc3 += map(load(lhs + i + 3 * w), load(rhs + i + 3 * w));
+        }
+        for (; i + w <= n; i += w) {
+            acc0 += map(load(lhs + i), load(rhs + i));
+        }
+        T res = sum<T>((acc0 + acc1) + (acc2 + acc3));
+        for (; i < n; ++i) {
+            res += map(lhs[i], rhs[i]);
+        }
+        return res;
+    }
+
+    // sum of map(src[i]), same accumulator layout as above
+    template< typename T, typename Map >
+    T reduce(const T* src, size_t n, Map map) {
+        const size_t w = width<T>;
+        Pack<T> acc0 = {}, acc1 = {}, acc2 = {}, acc3 = {};
+        size_t i = 0;
+        for (; i + 4 * w <= n; i += 4 * w) {
+            acc0 += map(load(src + i));
+            acc1 += map(load(src + i + w));
+            acc2 += map(load(src + i + 2 * w));
+            acc3 += map(load(src + i + 3 * w));
+        }
+        for (; i + w <= n; i += w) {
+            acc0 += map(load(src + i));
+        }
+        T res = sum<T>((acc0 + acc1) + (acc2 + acc3));
+        for (; i < n; ++i) {
+            res += map(src[i]);
+        }
+        return res;
+    }
+
+    /**
+     * op(...op(op(src[0], src[1]), src[2])..., src[n - 1]) for an associative
+     * and commutative op such as min or max; n must be positive
+     */
+    template< typename T, typename Op >
+    T fold(const T* src, size_t n, Op op) {
+        const size_t w = width<T>;
+        size_t i = 0;
+        T res = src[0];
+        if (n >= w) {
+            Pack<T> acc = load(src);
+            for (i = w; i + w <= n; i += w) {
+                acc = op(acc, load(src + i));
+            }
+            for (size_t lane = 0; lane < w; ++lane) {
+                res = op(res, acc[lane]);
+            }
+        }
+        for (; i < n; ++i) {
+            res = op(res, src[i]);
+        }
+        return res;
+    }
+
+    template< typename T >
+    T dot(const T* lhs, const T* rhs, size_t n) {
+        return reduce(lhs, rhs, n, [](auto x, auto y) { return x * y; });
+    }
+
+    // y[i] += alpha * x[i]
+    template< typename T >
+    void axpy(T alpha, const T* x, T* y, size_t n) {
+        binary(x, y, y, n, [alpha](auto a, auto b) { return alpha * a + b; });
+    }
+
+    // out[i] = alpha * x[i] + beta * y[i]
+    template< typename T >
+    void axpby(T alpha, const T* x, T beta, const T* y, T* out, size_t n) {
+        binary(x, y, out, n, [alpha, beta](auto a, auto b) { return alpha * a + beta * b; });
+    }
+
+    // (lhs - rhs) * weights without materializing the difference
+    template< typename T >
+    T diffDot(const T* lhs, const T* rhs, const T* weights, size_t n) {
+        const size_t w = width<T>;
+        Pack<T> acc0 = {}, acc1 = {};
+        size_t i = 0;
+        for (; i + 2 * w <= n; i += 2 * w) {
+            acc0 += (load(lhs + i) - load(rhs + i)) * load(weights + i);
+            acc1 += (load(lhs + i + w) - load(rhs + i + w)) * load(weights + i + w);
+        }
+        T res = sum<T>(acc0 + acc1);
+        for (; i < n; ++i) {
+            res += (lhs[i] - rhs[i]) * weights[i];
+        }
+        return res;
+    }
+
+}  // namespace simd
+}  // namespace task
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// longest token the fast reader parses, longer ones fail the stream
+#define MAX_TOKEN_LENGTH 128
+// a size header is trusted for preallocation only up to this many elements
+#define MAX_RESERVE (1u << 24)
+
+namespace task {
+
+    namespace detail {
+
+        // types that std::from_chars can parse
+        template< typename T >
+        constexpr bool charsParsable = std::is_arithmetic<T>::value
+                && !std::is_same<T, bool>::value
+                && !std::is_same<T, char>::value
+                && !std::is_same<T, signed char>::value
+                && !std::is_same<T, unsigned char>::value;
+
+        inline bool isSpace(int c) {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        /**
+         * Reads whitespace separated values straight from the stream buffer
+         * and parses them with std::from_chars, which skips the locale and
+         * sentry work a formatted >> does per value. Characters are consumed
+         * only up to the end of the last token read, so whatever follows
+         * stays in the stream. Errors are reported through the stream state
+         * the same way >> reports them.
+         */
+        template< typename T >
+        class TokenReader {
+        private:
+            std::istream& stream;
+            std::streambuf* buffer;
+            bool invalid = false;
+
+        public:
+            explicit TokenReader(std::istream& stream) : stream(stream), buffer(stream.rdbuf()) {}
+
+            // a token was found but it is not a T
+            bool malformed() const {
+                return invalid;
+            }
+
+            bool read(T& value) {
+                if constexpr (!charsParsable<T>) {
+                    invalid = !(stream >> value) && !stream.eof();
+                    return !stream.fail();
+                } else {
+                    if(!stream.good() || buffer == nullptr) {
+                        stream.setstate(std::ios::failbit);
+                        return false;
+                    }
+                    const int eof = std::char_traits<char>::eof();
+                    int c = buffer->sgetc();
+                    while (c != eof && isSpace(c)) {
+                        c = buffer->snextc();
+                    }
+
+                    char token[MAX_TOKEN_LENGTH];
+                    size_t length = 0;
+                    while (c != eof && !isSpace(c) && length < MAX_TOKEN_LENGTH) {
+                        token[length++] = static_cast<char>(c);
+                        c = buffer->snextc();
+                    }
+                    if(c == eof) {
+                        stream.setstate(std::ios::eofbit);
+                    }
+
+                    // from_chars does not take an explicit plus sign
+                    const char* first = token;
+                    if(length > 1 && token[0] == '+' && token[1] != '-') {
+                        ++first;
+                    }
+                    auto res = std::from_chars(first, token + length, value);
+                    const bool truncated = c != eof && !isSpace(c);
+                    if(length == 0 || truncated || res.ec != std::errc() || res.ptr != token + length) {
+                        invalid = length != 0;
+                        stream.setstate(std::ios::failbit);
+                        return false;
+                    }
+                    return true;
+                }
+            }
+        };
+
+    }  // namespace detail
+
+    /**
+     * Reads a vector written as "size v[0] v[1] ...": storage is reserved
+     * from the header and reading stops after size values. On any error v is
+     * left empty and the stream is failed.
+     */
+    template< typename T >
+    std::istream& read(std::istream& stream, std::vector<T>& v) {
+        v.clear();
+        size_t size;
+        if(!(stream >> size)) {
+            return stream;
+        }
+        v.reserve(std::min<size_t>(size, MAX_RESERVE));
+
+        detail::TokenReader<T> reader(stream);
+        T value;
+        for (size_t i = 0; i < size; ++i) {
+            if(!reader.read(value)) {
+                v.clear();
+                return stream;
+            }
+            v.push_back(value);
+        }
+        return stream;
+    }
+
+    /**
+     * Incremental reader for streams too large to hold at once: every next()
+     * refills the caller's vector with up to batchSize values, reusing its
+     * storage, until the stream or the optional count of values runs out.
+     *
+     *     BatchReader<double> reader(in, 4096);
+     *     std::vector<double> batch;
+     *     while (reader.next(batch)) {
+     *         ...
+     *     }
+     */
+    template< typename T >
+    class BatchReader {
+    private:
+        std::istream& stream;
+        detail::TokenReader<T> reader;
+        size_t batchSize;
+        size_t remaining;
+
+    public:
+        BatchReader(std::istream& stream, size_t batchSize,
+                    size_t count = std::numeric_limits<size_t>::max())
+            : stream(stream), reader(stream), batchSize(std::max<size_t>(batchSize, 1)), remaining(count) {}
+
+        // false once nothing was read; a short last batch is still returned
+        bool next(std::vector<T>& batch) {
+            batch.clear();
+            batch.reserve(std::min(batchSize, remaining));
+            T value;
+            while (batch.size() < batchSize && remaining > 0 && stream.good()) {
+                if(!reader.read(value)) {
+                    break;
+                }
+                batch.push_back(value);
+                --remaining;
+            }
+            return !batch.empty();
+        }
+
+        // true when reading stopped on a value that could not be parsed
+        bool failed() const {
+            return reader.malformed();
+        }
+    };
+
+}  // namespace task
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vector_ops.h"
+
+namespace task {
+
+    /**
+     * Fixed-size vector with the same operators as std::vector<T> in
+     * vector_ops.h. It lives on the stack, all operations are constexpr and
+     * sizes are checked at compile time. Element-wise operators and the dot
+     * product are expanded over an index sequence; == and the collinearity
+     * tests are plain loops over N, which the compiler may unroll.
+     */
+    template< typename T, size_t N >
+    struct Vec {
+        static_assert(N > 0, "Vec must have at least one element!");
+
+        T data[N];
+
+        constexpr Vec() : data{} {}
+
+        template< typename... Args, typename = std::enable_if_t<sizeof...(Args) == N
+                && std::conjunction<std::is_convertible<Args, T>...>::value> >
+        constexpr Vec(Args... args) : data{static_cast<T>(args)...} {}
+
+        explicit Vec(const std::vector<T>& v) : data{} {
+            if(v.size() != N) {
+                throw std::runtime_error("Vectors should be of same size!");
+            }
+            for(size_t i = 0; i < N; ++i) {
+                data[i] = v[i];
+            }
+        }
+
+        operator std::vector<T>() const {
+            return std::vector<T>(data, data + N);
+        }
+
+        static constexpr size_t size() {
+            return N;
+        }
+
+        constexpr T& operator [] (size_t i) {
+            return data[i];
+        }
+
+        constexpr const T& operator [] (size_t i) const {
+            return data[i];
+        }
+
+        constexpr bool operator == (const Vec& other) const {
+            for(size_t i = 0; i < N; ++i) {
+                if(data[i] != other.data[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr bool operator != (const Vec& other) const {
+            return !(*this == other);
+        }
+    };
+
+    namespace detail {
+
+        template< typename T, size_t N, typename Op, size_t... I >
+        constexpr Vec<T, N> map(const Vec<T, N>& v, Op op, std::index_sequence<I...>) {
+            return Vec<T, N>(op(v[I])...);
+        }
+
+        template< typename T, size_t N, typename Op, size_t... I >
+        constexpr Vec<T, N> map(const Vec<T, N>& lhs, const Vec<T, N>& rhs, Op op, std::index_sequence<I...>) {
+            return Vec<T, N>(op(lhs[I], rhs[I])...);
+        }
+
+        template< typename T, size_t N, size_t... I >
+        constexpr T dot(const Vec<T, N>& lhs, const Vec<T, N>& rhs, std::index_sequence<I...>) {
+            return ((lhs[I] * rhs[I]) + ...);
+        }
+
+        // sum over i < j of (lhs[i] * rhs[j] - lhs[j] * rhs[i])^2, which is
+        // |lhs x rhs|^2 in 3D and |lhs|^2 |rhs|^2 sin^2 in any dimension
+        template< typename T, size_t N >
+        constexpr double crossNorm2(const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+            double res = 0.0;
+            for(size_t i = 0; i < N; ++i) {
+                for(size_t j = i + 1; j < N; ++j) {
+                    double term = static_cast<double>(lhs[i]) * rhs[j] - static_cast<double>(lhs[j]) * rhs[i];
+                    res += term * term;
+                }
+            }
+            return res;
+        }
+
+    }  // namespace detail
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator + (const Vec<T, N>& v) {
+        return v;
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator - (const Vec<T, N>& v) {
+        return detail::map(v, [] (T x) { return -x; }, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator + (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        return detail::map(lhs, rhs, detail::plus, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator - (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        return detail::map(lhs, rhs, detail::minus, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    constexpr T operator * (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        return detail::dot(lhs, rhs, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator % (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        static_assert(N == THREE, "Vector product available only for 3D vectors!");
+        return Vec<T, N>(
+            lhs[1] * rhs[2] - lhs[2] * rhs[1],
+            lhs[2] * rhs[0] - lhs[0] * rhs[2],
+            lhs[0] * rhs[1] - lhs[1] * rhs[0]
+        );
+    }
+
+    // the sine of the angle between the vectors is at most EPSILON; a zero
+    // vector is collinear with any vector
+    template< typename T, size_t N >
+    constexpr bool operator || (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        const double lhsNorm2 = static_cast<double>(lhs * lhs);
+        const double rhsNorm2 = static_cast<double>(rhs * rhs);
+        return detail::crossNorm2(lhs, rhs) <= EPSILON * EPSILON * lhsNorm2 * rhsNorm2;
+    }
+
+    template< typename T, size_t N >
+    constexpr bool operator && (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        return (lhs || rhs) && lhs * rhs >= T();
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator | (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        static_assert(isBitwise<T>, "Bitwise or can be done only with integers!");
+        return detail::map(lhs, rhs, detail::bitOr, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    constexpr Vec<T, N> operator & (const Vec<T, N>& lhs, const Vec<T, N>& rhs) {
+        static_assert(isBitwise<T>, "Bitwise and can be done only with integers!");
+        return detail::map(lhs, rhs, detail::bitAnd, std::make_index_sequence<N>());
+    }
+
+    template< typename T, size_t N >
+    std::ostream& operator << (std::ostream& stream, const Vec<T, N>& v) {
+        for(size_t i = 0; i < N; ++i) {
+            stream << v[i] << " ";
+        }
+        stream << std::endl;
+        return stream;
+    }
+
+    template< typename T, size_t N >
+    constexpr void reverse(Vec<T, N>& v) {
+        for(size_t i = 0; i < N / 2; ++i) {
+            T tmp = v[i];
+            v[i] = v[N - 1 - i];
+            v[N - 1 - i] = tmp;
+        }
+    }
+
+    using Vec2 = Vec<double, 2>;
+    using Vec3 = Vec<double, 3>;
+
+}  // namespace task
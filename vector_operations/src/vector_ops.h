@@ -8,21 +8,95 @@
 #include <cmath>
 #include <numeric>
 
+#include "expression.h"
+#include "reduce.h"
+#include "simd.h"
+#include "stream.h"
+
 #define THREE 3
 #define EPSILON 1e-7
 
 namespace task {
 
-    template < typename T >
-    auto getZero = [] () -> T {
-        if(std::is_same<T, int>::value) {
-            return 0;
-        } else if(std::is_same<T, double>::value) {
-            return 0.0;
-        } else {
-            throw std::runtime_error("Only double or int allowed!");
+    // element types the operators are written for: arithmetic types but bool
+    template< typename T >
+    constexpr bool isElement = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+    // element types for | and &
+    template< typename T >
+    constexpr bool isBitwise = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+
+    template< typename T >
+    constexpr T getZero() {
+        static_assert(isElement<T>, "Only arithmetic element types allowed!");
+        return T();
+    }
+
+    namespace detail {
+
+        // out of line and cold, so that inlined callers keep only the comparison
+        [[noreturn]] __attribute__((noinline, cold)) inline void throwSizeMismatch() {
+            throw std::runtime_error("Vectors should be of same size!");
         }
-    };
+
+        template< typename T >
+        void checkSizes(const std::vector<T>& lhs, const std::vector<T>& rhs) {
+            if(__builtin_expect(lhs.size() != rhs.size(), 0)) {
+                throwSizeMismatch();
+            }
+        }
+
+        // element-wise op; types with SIMD kernels are written into presized storage
+        template< typename T, typename Op >
+        std::vector<T> zip(const std::vector<T>& lhs, const std::vector<T>& rhs, Op op) {
+            checkSizes(lhs, rhs);
+            if constexpr (simd::supported<T>) {
+                std::vector<T> res(lhs.size());
+                simd::binary(lhs.data(), rhs.data(), res.data(), lhs.size(), op);
+                return res;
+            } else {
+                std::vector<T> res;
+                res.reserve(lhs.size());
+                std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), op);
+                return res;
+            }
+        }
+
+        // out[i] = op(lhs[i], rhs[i]) for caller-owned out of lhs.size()
+        // elements; out may be lhs or rhs
+        template< typename T, typename Op >
+        void zipInto(const std::vector<T>& lhs, const std::vector<T>& rhs, T* out, Op op) {
+            checkSizes(lhs, rhs);
+            if constexpr (simd::supported<T>) {
+                simd::binary(lhs.data(), rhs.data(), out, lhs.size(), op);
+            } else {
+                std::transform(lhs.begin(), lhs.end(), rhs.begin(), out, op);
+            }
+        }
+
+        // same, resizing out first: its storage is reused when large enough
+        template< typename T, typename Op >
+        void zipInto(const std::vector<T>& lhs, const std::vector<T>& rhs, std::vector<T>& out, Op op) {
+            checkSizes(lhs, rhs);
+            out.resize(lhs.size());
+            zipInto(lhs, rhs, out.data(), op);
+        }
+
+        // keeps T deduced from the vector alone, so v *= 2 works for doubles
+        template< typename T >
+        struct Identity {
+            using type = T;
+        };
+
+        template< typename T >
+        using Scalar = typename Identity<T>::type;
+
+        constexpr auto plus = [] (auto lhs, auto rhs) { return lhs + rhs; };
+        constexpr auto minus = [] (auto lhs, auto rhs) { return lhs - rhs; };
+        constexpr auto bitOr = [] (auto lhs, auto rhs) { return lhs | rhs; };
+        constexpr auto bitAnd = [] (auto lhs, auto rhs) { return lhs & rhs; };
+
+    }  // namespace detail
 
     template< typename T>
     std::vector<T> operator + (const std::vector<T>& v) {
@@ -31,40 +105,176 @@ namespace task {
 
     template< typename T>
     std::vector<T> operator - (const std::vector<T>& v) {
-        std::vector<T> res;
-        res.reserve(v.size());
-        std::transform(v.begin(), v.end(), std::back_inserter(res), std::negate<T>());
-        return res;
+        if constexpr (simd::supported<T>) {
+            std::vector<T> res(v.size());
+            simd::unary(v.data(), res.data(), v.size(), [] (auto x) { return -x; });
+            return res;
+        } else {
+            std::vector<T> res;
+            res.reserve(v.size());
+            std::transform(v.begin(), v.end(), std::back_inserter(res), std::negate<T>());
+            return res;
+        }
     }
 
     template< typename T >
     std::vector<T> operator + (const std::vector<T>& lhs, const std::vector<T>& rhs) {
-        if(lhs.size() != rhs.size()) {
-            throw std::runtime_error("Vectors should be of same size!");
-        }
-        std::vector<T> res;
-        res.reserve(lhs.size());
-        std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), std::plus<T>());
-        return res;
+        return detail::zip(lhs, rhs, detail::plus);
     }
 
     template< typename T >
     std::vector<T> operator - (const std::vector<T>& lhs, const std::vector<T>& rhs) {
-        if(lhs.size() != rhs.size()) {
-            throw std::runtime_error("Vectors should be of same size!");
+        return detail::zip(lhs, rhs, detail::minus);
+    }
+
+    template< typename T >
+    std::vector<T>& operator += (std::vector<T>& lhs, const std::vector<T>& rhs) {
+        detail::zipInto(lhs, rhs, lhs.data(), detail::plus);
+        return lhs;
+    }
+
+    template< typename T >
+    std::vector<T>& operator -= (std::vector<T>& lhs, const std::vector<T>& rhs) {
+        detail::zipInto(lhs, rhs, lhs.data(), detail::minus);
+        return lhs;
+    }
+
+    template< typename T >
+    std::vector<T>& operator *= (std::vector<T>& v, const detail::Scalar<T>& alpha) {
+        if constexpr (simd::supported<T>) {
+            simd::unary(v.data(), v.data(), v.size(), [alpha] (auto x) { return alpha * x; });
+        } else {
+            for(size_t i = 0; i < v.size(); ++i) {
+                v[i] *= alpha;
+            }
         }
-        std::vector<T> res;
-        res.reserve(lhs.size());
-        std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), std::minus<T>());
-        return res;
+        return v;
+    }
+
+    /**
+     * Output-parameter versions of the element-wise operators. Out is either
+     * a vector, resized to the operand size and reallocated only when its
+     * capacity is too small, or a pointer to at least lhs.size() elements.
+     * Out may be one of the operands.
+     */
+    template< typename T, typename Out >
+    void add(const std::vector<T>& lhs, const std::vector<T>& rhs, Out&& out) {
+        detail::zipInto(lhs, rhs, out, detail::plus);
+    }
+
+    template< typename T, typename Out >
+    void subtract(const std::vector<T>& lhs, const std::vector<T>& rhs, Out&& out) {
+        detail::zipInto(lhs, rhs, out, detail::minus);
     }
 
     template< typename T >
-    T operator * (const std::vector<T>& lhs, const std::vector<T>& rhs) {
-        if(lhs.size() != rhs.size()) {
-            throw std::runtime_error("Vectors should be of same size!");
+    void negate(const std::vector<T>& v, T* out) {
+        if constexpr (simd::supported<T>) {
+            simd::unary(v.data(), out, v.size(), [] (auto x) { return -x; });
+        } else {
+            std::transform(v.begin(), v.end(), out, std::negate<T>());
+        }
+    }
+
+    template< typename T >
+    void negate(const std::vector<T>& v, std::vector<T>& out) {
+        out.resize(v.size());
+        negate(v, out.data());
+    }
+
+    template< typename T >
+    void scale(const detail::Scalar<T>& alpha, const std::vector<T>& v, T* out) {
+        if constexpr (simd::supported<T>) {
+            simd::unary(v.data(), out, v.size(), [alpha] (auto x) { return alpha * x; });
+        } else {
+            std::transform(v.begin(), v.end(), out, [&alpha] (const T& x) { return alpha * x; });
+        }
+    }
+
+    template< typename T >
+    void scale(const detail::Scalar<T>& alpha, const std::vector<T>& v, std::vector<T>& out) {
+        out.resize(v.size());
+        scale(alpha, v, out.data());
+    }
+
+    namespace detail {
+
+        // a * b for vectors of at least one unrolled block of SIMD packs; kept
+        // out of line so that the short path in operator * stays cheap
+        template< typename T >
+        __attribute__((noinline)) T longDot(const std::vector<T>& lhs, const std::vector<T>& rhs) {
+            // below the parallel threshold the kernel is called directly,
+            // without the reduction dispatch
+            if(lhs.size() < PARALLEL_THRESHOLD) {
+                return simd::dot(lhs.data(), rhs.data(), lhs.size());
+            }
+            return dot(lhs, rhs);
+        }
+
+    }  // namespace detail
+
+    template< typename T >
+    inline T operator * (const std::vector<T>& lhs, const std::vector<T>& rhs) {
+        detail::checkSizes(lhs, rhs);
+        if constexpr (simd::supported<T>) {
+            const size_t n = lhs.size();
+            // too short for one unrolled block of packs: a scalar loop without
+            // any SIMD setup, small enough to be inlined at the call site. Two
+            // accumulators halve the chain of dependent additions
+            if(n < 4 * simd::width<T>) {
+                const T* l = lhs.data();
+                const T* r = rhs.data();
+                T even = T();
+                T odd = T();
+                size_t i = 0;
+                for (; i + 2 <= n; i += 2) {
+                    even += l[i] * r[i];
+                    odd += l[i + 1] * r[i + 1];
+                }
+                if (i < n) {
+                    even += l[i] * r[i];
+                }
+                return even + odd;
+            }
+            return detail::longDot(lhs, rhs);
+        } else {
+            return std::inner_product(lhs.begin(), lhs.end(), rhs.begin(), getZero<T>());
+        }
+    }
+
+    // y = alpha * x + y, in place
+    template< typename T >
+    void axpy(const T& alpha, const std::vector<T>& x, std::vector<T>& y) {
+        detail::checkSizes(x, y);
+        if constexpr (simd::supported<T>) {
+            simd::axpy(alpha, x.data(), y.data(), x.size());
+        } else {
+            for(size_t i = 0; i < x.size(); ++i) {
+                y[i] += alpha * x[i];
+            }
+        }
+    }
+
+    // alpha * x + beta * y in one pass
+    template< typename T >
+    std::vector<T> axpby(const T& alpha, const std::vector<T>& x, const T& beta, const std::vector<T>& y) {
+        return detail::zip(x, y, [alpha, beta] (auto a, auto b) { return alpha * a + beta * b; });
+    }
+
+    // (lhs - rhs) * weights without building lhs - rhs
+    template< typename T >
+    T diffDot(const std::vector<T>& lhs, const std::vector<T>& rhs, const std::vector<T>& weights) {
+        detail::checkSizes(lhs, rhs);
+        detail::checkSizes(lhs, weights);
+        if constexpr (simd::supported<T>) {
+            return simd::diffDot(lhs.data(), rhs.data(), weights.data(), lhs.size());
+        } else {
+            T res = getZero<T>();
+            for(size_t i = 0; i < lhs.size(); ++i) {
+                res += (lhs[i] - rhs[i]) * weights[i];
+            }
+            return res;
         }
-        return std::inner_product(lhs.begin(), lhs.end(), rhs.begin(), getZero<T>());
     }
 
     template< typename T >
@@ -115,12 +325,7 @@ namespace task {
 
     template< typename T >
     std::istream& operator >> (std::istream& stream, std::vector<T>& v) {
-        size_t size;
-        stream >> size;
-
-        v.clear();
-        std::copy(std::istream_iterator<T>(stream), std::istream_iterator<T>(), std::back_inserter(v));
-        return stream;
+        return read(stream, v);
     }
 
     template< typename T >
@@ -140,30 +345,40 @@ namespace task {
 
     template< typename T >
     std::vector<T> operator | (const std::vector<T>& lhs, const std::vector<T>& rhs) {
-        if(!std::is_same<T, int>::value) {
-            throw std::runtime_error("Bitwise or can be done only with ints!");
-        }
-        if(lhs.size() != rhs.size()) {
-            throw std::runtime_error("Vectors should be of same size!");
-        }
-        std::vector<T> res;
-        res.reserve(lhs.size());
-        std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), std::bit_or<T>());
-        return res;
+        static_assert(isBitwise<T>, "Bitwise or can be done only with integers!");
+        return detail::zip(lhs, rhs, detail::bitOr);
     }
 
     template< typename T >
     std::vector<T> operator & (const std::vector<T>& lhs, const std::vector<T>& rhs) {
-        if(!std::is_same<T, int>::value) {
-            throw std::runtime_error("Bitwise and can be done only with ints!");
-        }
-        if(lhs.size() != rhs.size()) {
-            throw std::runtime_error("Vectors should be of same size!");
-        }
-        std::vector<T> res;
-        res.reserve(lhs.size());
-        std::transform(lhs.begin(), lhs.end(), rhs.begin(), std::back_inserter(res), std::bit_and<T>());
-        return res;
+        static_assert(isBitwise<T>, "Bitwise and can be done only with integers!");
+        return detail::zip(lhs, rhs, detail::bitAnd);
+    }
+
+    template< typename T >
+    std::vector<T>& operator |= (std::vector<T>& lhs, const std::vector<T>& rhs) {
+        static_assert(isBitwise<T>, "Bitwise or can be done only with integers!");
+        detail::zipInto(lhs, rhs, lhs.data(), detail::bitOr);
+        return lhs;
+    }
+
+    template< typename T >
+    std::vector<T>& operator &= (std::vector<T>& lhs, const std::vector<T>& rhs) {
+        static_assert(isBitwise<T>, "Bitwise and can be done only with integers!");
+        detail::zipInto(lhs, rhs, lhs.data(), detail::bitAnd);
+        return lhs;
+    }
+
+    template< typename T, typename Out >
+    void bitwiseOr(const std::vector<T>& lhs, const std::vector<T>& rhs, Out&& out) {
+        static_assert(isBitwise<T>, "Bitwise or can be done only with integers!");
+        detail::zipInto(lhs, rhs, out, detail::bitOr);
+    }
+
+    template< typename T, typename Out >
+    void bitwiseAnd(const std::vector<T>& lhs, const std::vector<T>& rhs, Out&& out) {
+        static_assert(isBitwise<T>, "Bitwise and can be done only with integers!");
+        detail::zipInto(lhs, rhs, out, detail::bitAnd);
     }
 
 
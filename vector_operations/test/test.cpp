@@ -6,7 +6,10 @@
 #include <valarray>
 #include <sstream>
 #include <cmath>
+#include <climits>
 #include "src/vector_ops.h"
+#include "src/batch3d.h"
+#include "src/vec.h"
 
 
 using namespace task;
@@ -137,6 +140,32 @@ int main() {
         ASSERT_TRUE_MSG(fabs(res - res2) < EPS, "Dot product")
     }
 
+    {
+        // every 1 is lost to rounding next to 1e16 unless it is compensated
+        std::vector<double> vec;
+        for (size_t i = 0; i < 1000; ++i) {
+            vec.push_back(1e16);
+            vec.push_back(1.);
+            vec.push_back(-1e16);
+        }
+        std::vector<double> ones(vec.size(), 1.);
+
+        ASSERT_TRUE_MSG(sum(vec, Summation::COMPENSATED) == 1000., "Compensated sum")
+        ASSERT_TRUE_MSG(dot(vec, ones, Summation::COMPENSATED) == 1000., "Compensated dot product")
+    }
+
+    REPEAT(10)
+    {
+        // long enough to be split between threads
+        std::vector<double> vec;
+        RandomFillDouble(vec, PARALLEL_THRESHOLD + RandomUInt(1000));
+        std::valarray<double> valarr(vec.data(), vec.size());
+
+        ASSERT_TRUE_MSG(fabs(sum(vec) - valarr.sum()) < 1e-6, "Parallel sum")
+        ASSERT_TRUE_MSG(fabs(sum(vec, Summation::COMPENSATED) - valarr.sum()) < 1e-6, "Parallel compensated sum")
+        ASSERT_TRUE_MSG(min(vec) == valarr.min() && max(vec) == valarr.max(), "Parallel min and max")
+    }
+
     REPEAT(100)
     {
         std::vector<int> vec, vec2;
@@ -159,6 +188,116 @@ int main() {
         ASSERT_EQUAL_MSG(vec, valarr, "Bitwise AND")
     }
 
+    REPEAT(100)
+    {
+        std::vector<double> a, b, c;
+        RandomFillDouble(a, RandomUInt(0, 1000));
+        RandomFillDouble(b, a.size());
+        RandomFillDouble(c, a.size());
+
+        std::vector<double> res = -(expr::lazy(a) + b - c);
+        std::vector<double> expected = -(a + b - c);
+
+        ASSERT_EQUAL_MSG(res, expected, "Lazy expression")
+
+
+        expr::evaluate(expr::lazy(a) - a + b, a);
+
+        ASSERT_EQUAL_MSG(a, b, "Lazy expression into an operand")
+    }
+
+    REPEAT(100)
+    {
+        std::vector<int> a, b, c;
+        RandomFill(a, RandomUInt(0, 1000));
+        RandomFill(b, a.size());
+        RandomFill(c, a.size());
+
+        std::vector<int> res;
+        expr::evaluate((expr::lazy(a) | b) & c, res);
+        std::vector<int> expected = (a | b) & c;
+
+        ASSERT_EQUAL_MSG(res, expected, "Lazy bitwise expression")
+    }
+
+    REPEAT(100)
+    {
+        std::vector<double> a, b;
+        RandomFillDouble(a, RandomUInt(0, 1000));
+        RandomFillDouble(b, a.size());
+        const double alpha = RandomDouble(), beta = RandomDouble();
+
+        std::vector<double> res = a, expected = a + b;
+        res += b;
+        ASSERT_EQUAL_MSG(res, expected, "Compound +=")
+
+        res = a;
+        expected = a - b;
+        res -= b;
+        ASSERT_EQUAL_MSG(res, expected, "Compound -=")
+
+        res = a;
+        res *= alpha;
+        for (size_t i = 0; i < a.size(); ++i) {
+            ASSERT_TRUE_MSG(res[i] == alpha * a[i], "Compound *=")
+        }
+
+        std::vector<double> out(2000);
+        const double* storage = out.data();
+        add(a, b, out);
+        expected = a + b;
+        ASSERT_TRUE_MSG(out.data() == storage, "Output parameter is not reallocated")
+        ASSERT_EQUAL_MSG(out, expected, "Output parameter add")
+
+        subtract(a, b, out.data());
+        expected = a - b;
+        ASSERT_TRUE(std::equal(expected.begin(), expected.end(), out.begin()))
+
+        negate(a, out);
+        expected = -a;
+        ASSERT_EQUAL_MSG(out, expected, "Output parameter negate")
+
+        res = a;
+        add(res, b, res);
+        expected = a + b;
+        ASSERT_EQUAL_MSG(res, expected, "Output parameter aliasing an operand")
+
+        res = b;
+        axpy(alpha, a, res);
+        std::vector<double> res2 = axpby(alpha, a, beta, b);
+        for (size_t i = 0; i < a.size(); ++i) {
+            ASSERT_TRUE_MSG(fabs(res[i] - (alpha * a[i] + b[i])) < EPS, "axpy")
+            ASSERT_TRUE_MSG(fabs(res2[i] - (alpha * a[i] + beta * b[i])) < EPS, "axpby")
+        }
+
+        expected = a - b;
+        ASSERT_TRUE_MSG(fabs(diffDot(a, b, res) - expected * res) < 1e-6, "diffDot")
+    }
+
+    REPEAT(100)
+    {
+        std::vector<int> a, b;
+        RandomFill(a, RandomUInt(0, 1000));
+        RandomFill(b, a.size());
+
+        std::vector<int> res = a, expected = a | b;
+        res |= b;
+        ASSERT_EQUAL_MSG(res, expected, "Compound |=")
+
+        res = a;
+        expected = a & b;
+        res &= b;
+        ASSERT_EQUAL_MSG(res, expected, "Compound &=")
+
+        bitwiseOr(a, b, res);
+        expected = a | b;
+        ASSERT_EQUAL_MSG(res, expected, "Output parameter bitwise or")
+
+        bitwiseAnd(a, b, res.data());
+        expected = a & b;
+        ASSERT_EQUAL_MSG(res, expected, "Output parameter bitwise and")
+    }
+
     REPEAT(100)
     {
         std::vector<double> vec, vec2;
@@ -202,6 +341,95 @@ int main() {
         ASSERT_TRUE_MSG(!(vec && vec2), "Codirectionality operator")
     }
 
+    REPEAT(100)
+    {
+        Vectors3<double> lhs, rhs, cross;
+        size_t count = RandomUInt(0, 100);
+        for (size_t i = 0; i < count; ++i) {
+            std::vector<double> vec, vec2;
+            RandomFillDouble(vec, 3);
+            double alpha = RandomDouble();
+            switch (RandomUInt(3)) {
+                case 0: vec2 = {alpha * vec[0], alpha * vec[1], alpha * vec[2]}; break;
+                case 1: vec2 = {-fabs(alpha) * vec[0], -fabs(alpha) * vec[1], -fabs(alpha) * vec[2]}; break;
+                case 2: vec2 = std::vector<double>(3, 0.); break;
+                default: RandomFillDouble(vec2, 3);
+            }
+            lhs.push_back(vec);
+            rhs.push_back(vec2);
+        }
+
+        std::vector<uint8_t> collinearMask, codirectedMask;
+        task::cross(lhs, rhs, cross);
+        collinear(lhs, rhs, collinearMask);
+        codirected(lhs, rhs, codirectedMask);
+
+        ASSERT_TRUE(cross.size() == count && collinearMask.size() == count && codirectedMask.size() == count)
+        for (size_t i = 0; i < count; ++i) {
+            auto expected = lhs.at(i) % rhs.at(i);
+            auto res = cross.at(i);
+            for (size_t j = 0; j < 3; ++j) {
+                ASSERT_TRUE_MSG(fabs(res[j] - expected[j]) < EPS, "Batched cross product")
+            }
+            // a zero vector is collinear and codirected with anything
+            std::vector<double> l = lhs.at(i), r = rhs.at(i);
+            bool zero = r == std::vector<double>(3, 0.);
+            ASSERT_TRUE_MSG(bool(collinearMask[i]) == (zero || (l || r)), "Batched collinearity")
+            ASSERT_TRUE_MSG(bool(codirectedMask[i]) == (zero || (l && r)), "Batched codirectionality")
+        }
+    }
+
+    {
+        // cross and dot products of these overflow int
+        const int big = INT_MAX / 2;
+        Vectors3<int> lhs, rhs;
+        lhs.push_back(30000, 40000, 50000);
+        rhs.push_back(60000, 80000, 100000);
+        lhs.push_back(30000, 40000, 50000);
+        rhs.push_back(-30000, -40000, -50001);
+        lhs.push_back(0, 0, 0);
+        rhs.push_back(1, 2, 3);
+        lhs.push_back(big, big, big - 1);
+        rhs.push_back(big, big, big - 1);
+        lhs.push_back(big, big, big - 1);
+        rhs.push_back(-big, -big, 1 - big);
+        // a x b == 2^32 e_z, which is zero modulo 2^32
+        lhs.push_back(1 << 30, 0, 0);
+        rhs.push_back(0, 4, 0);
+        lhs.push_back(1 << 20, 1 << 20, 0);
+        rhs.push_back(1 << 20, (1 << 20) + 1, 0);
+
+        std::vector<uint8_t> collinearMask, codirectedMask;
+        collinear(lhs, rhs, collinearMask);
+        codirected(lhs, rhs, codirectedMask);
+
+        std::vector<uint8_t> expectedCollinear {1, 0, 1, 1, 1, 0, 0};
+        std::vector<uint8_t> expectedCodirected {1, 0, 1, 1, 0, 0, 0};
+        ASSERT_TRUE_MSG(collinearMask == expectedCollinear, "Batched integer collinearity")
+        ASSERT_TRUE_MSG(codirectedMask == expectedCodirected, "Batched integer codirectionality")
+
+        // the products overflow, the components themselves fit
+        Vectors3<int> products;
+        cross(lhs, rhs, products);
+        ASSERT_TRUE_MSG(products.at(3) == std::vector<int>(3, 0), "Batched integer cross product")
+        ASSERT_TRUE_MSG(products.at(6) == (std::vector<int> {0, 0, 1 << 20}), "Batched integer cross product")
+    }
+
+    {
+        const long long big = LLONG_MAX / 2;
+        Vectors3<long long> lhs, rhs;
+        lhs.push_back(big, big - 1, 3);
+        rhs.push_back(-big, 1 - big, -3);
+        lhs.push_back(big, big - 1, 3);
+        rhs.push_back(big - 1, big, 3);
+
+        std::vector<uint8_t> collinearMask, codirectedMask;
+        collinear(lhs, rhs, collinearMask);
+        codirected(lhs, rhs, codirectedMask);
+        ASSERT_TRUE_MSG(collinearMask[0] && !collinearMask[1], "Batched 64-bit collinearity")
+        ASSERT_TRUE_MSG(!codirectedMask[0] && !codirectedMask[1], "Batched 64-bit codirectionality")
+    }
+
     REPEAT(100)
     {
         std::vector<double> vec, vec2;
@@ -227,6 +455,23 @@ int main() {
 
         ASSERT_TRUE_MSG(vec.empty() && vec2.empty(), "Stream input operator")
 
+        stream.clear();
+        stream.str("3 1 +2 -3.5 4");
+        stream >> vec;
+        ASSERT_TRUE_MSG(vec.size() == 3 && vec[1] == 2. && vec[2] == -3.5, "Stream input stops at size")
+        stream >> vec2;
+        ASSERT_TRUE_MSG(stream.fail() && vec2.empty(), "Stream input without size")
+
+        stream.clear();
+        stream.str("3 1 x 3");
+        stream >> vec;
+        ASSERT_TRUE_MSG(stream.fail() && vec.empty(), "Stream input of a malformed value")
+
+        stream.clear();
+        stream.str("5 1 2");
+        stream >> vec;
+        ASSERT_TRUE_MSG(stream.fail() && vec.empty(), "Stream input shorter than size")
+
         RandomFillDouble(vec2, RandomUInt(800, 1000));
         vec = vec2;
         reverse(vec);
@@ -235,4 +480,107 @@ int main() {
         ASSERT_EQUAL_MSG(vec, vec2, "reverse")
     }
 
+    {
+        std::stringstream stream("1 2 3 4 5 6 7");
+        BatchReader<int> reader(stream, 3);
+        std::vector<int> batch;
+
+        ASSERT_TRUE_MSG(reader.next(batch) && batch == std::vector<int>({1, 2, 3}), "BatchReader")
+        ASSERT_TRUE_MSG(reader.next(batch) && batch == std::vector<int>({4, 5, 6}), "BatchReader")
+        ASSERT_TRUE_MSG(reader.next(batch) && batch == std::vector<int>({7}), "BatchReader short batch")
+        ASSERT_TRUE_MSG(!reader.next(batch) && batch.empty() && !reader.failed(), "BatchReader end of stream")
+    }
+
+    {
+        std::stringstream stream("1 2 3 4 5 6 7");
+        BatchReader<int> reader(stream, 3, 5);
+        std::vector<int> batch;
+
+        ASSERT_TRUE_MSG(reader.next(batch) && reader.next(batch) && batch == std::vector<int>({4, 5}), "BatchReader count")
+        ASSERT_TRUE_MSG(!reader.next(batch), "BatchReader count")
+
+        int rest;
+        ASSERT_TRUE_MSG(stream >> rest && rest == 6, "BatchReader leaves the rest in the stream")
+    }
+
+    {
+        std::stringstream stream("1 2 oops 4");
+        BatchReader<double> reader(stream, 10);
+        std::vector<double> batch;
+
+        ASSERT_TRUE_MSG(reader.next(batch) && batch.size() == 2 && reader.failed(), "BatchReader malformed value")
+        ASSERT_TRUE_MSG(!reader.next(batch), "BatchReader malformed value")
+    }
+
+    {
+        constexpr Vec<int, 3> a(1, 2, 3), b(4, 5, 6);
+
+        static_assert(a + b == Vec<int, 3>(5, 7, 9), "Constexpr Vec +");
+        static_assert(-a == Vec<int, 3>(-1, -2, -3), "Constexpr Vec unary -");
+        static_assert(a * b == 32, "Constexpr Vec dot product");
+        static_assert(a % b == Vec<int, 3>(-3, 6, -3), "Constexpr Vec cross product");
+        static_assert((a || a + a) && !(a || b) && (a && a) && !(a && -a), "Constexpr Vec collinearity");
+        static_assert((a | b) == Vec<int, 3>(5, 7, 7) && (a & b) == Vec<int, 3>(0, 0, 2), "Constexpr Vec bitwise");
+        static_assert(sizeof(a) == 3 * sizeof(int), "Vec keeps only its elements");
+    }
+
+    REPEAT(100)
+    {
+        std::vector<double> vec, vec2;
+        RandomFillDouble(vec, 3);
+        RandomFillDouble(vec2, 3);
+        Vec3 a(vec), b(vec2);
+
+        std::vector<double> res = a + b, expected = vec + vec2;
+        ASSERT_EQUAL_MSG(res, expected, "Vec +")
+
+        res = a - b;
+        expected = vec - vec2;
+        ASSERT_EQUAL_MSG(res, expected, "Vec -")
+
+        res = a % b;
+        expected = vec % vec2;
+        ASSERT_EQUAL_MSG(res, expected, "Vec cross product")
+
+        ASSERT_TRUE_MSG(fabs(a * b - vec * vec2) < EPS, "Vec dot product")
+    }
+
+    {
+        static_assert(isElement<int> && isElement<uint64_t> && isElement<float> && !isElement<bool>,
+                      "Element types");
+        static_assert(isBitwise<int> && isBitwise<int64_t> && !isBitwise<bool> && !isBitwise<double>,
+                      "Bitwise element types");
+        static_assert(getZero<int>() == 0 && getZero<double>() == 0.0, "getZero");
+    }
+
+    REPEAT(100)
+    {
+        std::vector<int64_t> a, b;
+        std::vector<uint64_t> c, d;
+        std::vector<float> e, f;
+        RandomFill(a, RandomUInt(1, 1000), 1000000);
+        RandomFill(b, a.size(), 1000000);
+        RandomFill(c, a.size());
+        RandomFill(d, a.size());
+        RandomFillDouble(e, a.size());
+        RandomFillDouble(f, a.size());
+        std::valarray<int64_t> va(a.data(), a.size()), vb(b.data(), b.size());
+        std::valarray<uint64_t> vc(c.data(), c.size()), vd(d.data(), d.size());
+
+        std::vector<int64_t> res = a - b;
+        std::valarray<int64_t> expected = va - vb;
+        ASSERT_EQUAL_MSG(res, expected, "int64_t -")
+        ASSERT_TRUE_MSG(a * b == (va * vb).sum(), "int64_t dot product")
+        ASSERT_TRUE_MSG(sum(a) == va.sum() && min(a) == va.min() && max(a) == va.max(), "int64_t reductions")
+
+        std::vector<uint64_t> res2 = (c | d) & c;
+        std::valarray<uint64_t> expected2 = (vc | vd) & vc;
+        ASSERT_EQUAL_MSG(res2, expected2, "uint64_t bitwise")
+
+        std::vector<float> res3 = e + f;
+        for (size_t i = 0; i < e.size(); ++i) {
+            ASSERT_TRUE_MSG(res3[i] == e[i] + f[i], "float +")
+        }
+    }
+
 }